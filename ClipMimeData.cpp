@@ -0,0 +1,147 @@
+#include "Trace.h"
+#include "ClipMimeData.h"
+#include "Representation.h"
+
+static const QString text_format{"text/plain"};
+static const QString html_format{"text/html"};
+
+ClipMimeData::ClipMimeData(const QString& text, const QString& html) : m_html(html), m_text(text)
+{
+    m_text_derived = !m_text.isEmpty() || m_html.isEmpty();
+}
+
+ClipMimeData::ClipMimeData(const QString& preview, bool has_html)
+    : m_pending(true),
+      m_has_html(has_html),
+      m_preview(preview)
+{
+}
+
+//------------------------------------------------
+// Factory methods
+
+ClipMimeData* ClipMimeData::from_blocks(const QByteArray& text_block, const QByteArray& html_block, int sender, uint32_t message_id)
+{
+    auto data{new ClipMimeData(QString(), QString())};
+    data->m_text_block = text_block;
+    data->m_html_block = html_block;
+    data->m_sender = sender;
+    data->m_message_id = message_id;
+    data->m_text_derived = !text_block.isEmpty() || html_block.isEmpty();
+    return data;
+}
+
+QByteArray ClipMimeData::compress(const QString& representation)
+{
+    return representation.isEmpty() ? QByteArray() : qCompress(representation.toUtf8());
+}
+
+QString ClipMimeData::inflate(const QByteArray& block)
+{
+    return block.isEmpty() ? QString() : QString::fromUtf8(qUncompress(block));
+}
+
+//------------------------------------------------
+// Instance methods
+
+void ClipMimeData::fulfil(const ClipMimeData& body)
+{
+    m_text_block = body.m_text_block;
+    m_html_block = body.m_html_block;
+    m_sender = body.m_sender;
+    m_message_id = body.m_message_id;
+    m_html = body.m_html;
+    m_text = body.m_text;
+    m_text_derived = body.m_text_derived;
+
+    m_pending = false;
+    m_preview.clear();
+
+    emit signal_fulfilled();
+}
+
+void ClipMimeData::abandon()
+{
+    if (!m_pending)
+        return;
+
+    m_text.clear();
+    m_text_derived = true;
+
+    m_pending = false;
+    m_has_html = false;
+    m_preview.clear();
+
+    emit signal_fulfilled();
+}
+
+QStringList ClipMimeData::formats() const
+{
+    QStringList result;
+    if (m_pending)
+    {
+        result << text_format;
+        if (m_has_html)
+            result << html_format;
+        return result;
+    }
+
+    auto has_html{!m_html.isEmpty() || !m_html_block.isEmpty()};
+    if (!m_text.isEmpty() || !m_text_block.isEmpty() || has_html)
+        result << text_format;
+    if (has_html)
+        result << html_format;
+    return result;
+}
+
+bool ClipMimeData::hasFormat(const QString& mime_type) const
+{
+    return formats().contains(mime_type);
+}
+
+QVariant ClipMimeData::retrieveData(const QString& mime_type, QVariant::Type type) const
+{
+    // never wait here for the body by running the event loop: anything it
+    // delivers may replace the clipboard, which deletes this object while
+    // its retrieveData() is still on the stack.  better a prefix of the
+    // copy than the stale clipboard it replaced.
+    if (m_pending && (mime_type == text_format || mime_type == html_format))
+        return mime_type == text_format ? QVariant(m_preview) : QVariant(m_preview.toHtmlEscaped());
+
+    if (mime_type == text_format)
+    {
+        if (!m_text_block.isEmpty())
+        {
+            // the paste waits on this, so it belongs in the copy's trace
+            TraceScope scope(Trace::Stage::Decompress, m_sender, m_message_id);
+            m_text = inflate(m_text_block);
+            m_text_block.clear();
+        }
+        else if (!m_text_derived)
+        {
+            m_text = Representation::html_to_text(html_representation());
+            m_text_derived = true;
+        }
+        return m_text;
+    }
+
+    if (mime_type == html_format)
+    {
+        auto& html{html_representation()};
+        if (!html.isEmpty())
+            return html;
+    }
+
+    return QMimeData::retrieveData(mime_type, type);
+}
+
+const QString& ClipMimeData::html_representation() const
+{
+    if (!m_html_block.isEmpty())
+    {
+        TraceScope scope(Trace::Stage::Decompress, m_sender, m_message_id);
+        m_html = inflate(m_html_block);
+        m_html_block.clear();
+    }
+    return m_html;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+
+#include <QString>
+#include <QVariant>
+#include <QByteArray>
+#include <QMimeData>
+#include <QStringList>
+
+// The clipboard data applied for a peer's copy.
+//
+// A peer sends only HTML when the plain text can be derived from it (see
+// Representation), yet still offers plain text to applications.  The text
+// is derived in retrieveData() the first time an application asks for it,
+// so a copy that is only ever pasted as rich text never pays for it.
+//
+// A large copy arrives with each representation compressed separately, and
+// is held that way: a representation is inflated the first time an
+// application asks for it, so memory and CPU scale with the formats that
+// are actually pasted rather than with what was copied.
+//
+// For a large copy, a peer first announces it with a preview.  The data
+// applied for the preview is "pending": it already offers the copy's
+// formats, and an application that pastes before fulfil() has provided
+// the body gets the preview text.  If the body never arrives, abandon()
+// leaves the data empty; a prefix is never passed off as the copy.
+
+class ClipMimeData : public QMimeData
+{
+    Q_OBJECT
+
+public:
+    ClipMimeData(const QString& text, const QString& html);
+
+    /*!
+    Construct pending data for a copy whose body is still on its way.
+
+    \param preview The leading text of the copy.
+    \param has_html Whether the copy will offer HTML.
+    */
+    ClipMimeData(const QString& preview, bool has_html);
+
+    /*!
+    Construct data whose representations stay compressed until asked for.
+
+    \param text_block The plain text as a compress() block; if empty, it is derived from the HTML.
+    \param html_block The HTML as a compress() block, if any.
+    \param sender The peer the copy came from, for tracing the inflation.
+    \param message_id The copy's message id, likewise.
+    \returns The new data.
+    */
+    static ClipMimeData* from_blocks(const QByteArray& text_block, const QByteArray& html_block, int sender, uint32_t message_id);
+
+    /*!
+    Compress a representation for from_blocks().
+
+    \param representation The text or HTML to compress.
+    \returns The compressed UTF-8, or an empty block for an empty representation.
+    */
+    static QByteArray compress(const QString& representation);
+
+    /*!
+    Reverse compress().
+
+    \param block A block produced by compress().
+    \returns The representation, or an empty string if the block is empty or corrupt.
+    */
+    static QString inflate(const QByteArray& block);
+
+    bool is_pending() const { return m_pending; }
+
+    /*!
+    Provide the body of pending data.
+
+    \param body Data holding the body of the copy; its representations are shared, not inflated.
+    */
+    void fulfil(const ClipMimeData& body);
+
+    // give up on the body; the data offers nothing from then on
+    void abandon();
+
+    QStringList formats() const override;
+    bool hasFormat(const QString& mime_type) const override;
+
+signals:
+    void signal_fulfilled();
+
+protected:
+    QVariant retrieveData(const QString& mime_type, QVariant::Type type) const override;
+
+private: // methods
+    const QString& html_representation() const;
+
+private: // data members
+    mutable QByteArray m_text_block;    // emptied once inflated
+    mutable QByteArray m_html_block;
+    int m_sender{0};                    // of the blocks, for tracing
+    uint32_t m_message_id{0};
+
+    mutable QString m_html;
+    mutable QString m_text;
+    mutable bool m_text_derived{false};
+
+    bool m_pending{false};
+    bool m_has_html{false};     // while pending
+    QString m_preview;
+};
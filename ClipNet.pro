@@ -1,9 +1,11 @@
-QT += core gui network
+QT += core gui network concurrent
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
 CONFIG += c++17
 
-# choose your (pseudo-)cryptographic poison
+# choose your (pseudo-)cryptographic poison; add more than one to talk
+# to members that encrypt with another (the "cipher" setting picks the
+# one we send with)
 CONFIG += cryptopp
 #CONFIG += simplecrypt
 #CONFIG += obfuscate
@@ -34,15 +36,35 @@ mac {
 
 unix:!mac {
     DEFINES += QT_LINUX
+
+    # for the Secret Service keystore (see KeyStore.h)
+    QT += dbus
+
+    # for XFixes clipboard notifications (see ClipboardPoller.h); without
+    # them (Qt 6 has no x11extras), the clipboard is polled instead
+    qtHaveModule(x11extras) {
+        QT += x11extras
+        DEFINES += CLIPNET_XFIXES
+        LIBS += -lxcb -lxcb-xfixes
+    }
     INCLUDEPATH += ../miniaudio
+
+    # USDT probes for bpftrace/perf (see Probes.h); they cost a NOP
+    # per site, so they are on whenever the SDT header is available
+    exists(/usr/include/sys/sdt.h) {
+        DEFINES += CLIPNET_USDT
+    }
 }
 
 win32 {
     DEFINES += QT_WIN
 
-    # for Registry API
+    # for Registry and Credential Manager APIs
     LIBS += -ladvapi32
 
+    # for GetClipboardSequenceNumber()
+    LIBS += -luser32
+
     CONFIG(static) {
         # make sure we match the linkage for Crypto++
         CONFIG(debug, debug|release) {
@@ -56,85 +78,58 @@ win32 {
 }
 
 SOURCES += \
+    ClipMimeData.cpp \
+    ClipboardPoller.cpp \
+    CryptoBackend.cpp \
     Cue.cpp \
+    FlightRecorder.cpp \
+    History.cpp \
+    HistoryIndex.cpp \
+    KeyStore.cpp \
+    LogModel.cpp \
+    Metrics.cpp \
+    Payload.cpp \
     Receiver.cpp \
+    Representation.cpp \
     Secure.cpp \
     Sender.cpp \
+    StatsServer.cpp \
+    TimerWheel.cpp \
+    Trace.cpp \
     main.cpp \
     mainwindow.cpp
 
 HEADERS += \
+    ClipMimeData.h \
+    ClipboardPoller.h \
+    CryptoBackend.h \
     Cue.h \
+    FlightRecord.h \
+    FlightRecorder.h \
+    History.h \
+    HistoryIndex.h \
+    HybridClock.h \
+    KeyRing.h \
+    KeyStore.h \
+    LogModel.h \
+    Metrics.h \
+    Packet.h \
+    Payload.h \
+    Probes.h \
     Receiver.h \
+    Representation.h \
     Secure.h \
     Sender.h \
+    SipHash.h \
+    StatsServer.h \
+    TimerWheel.h \
+    Trace.h \
     mainwindow.h
 
 FORMS += \
     mainwindow.ui
 
-cryptopp {
-    CRYPTOPP_PREFIX = $$(CRYPTOPP_INSTALL_ROOT)
-    isEmpty(CRYPTOPP_PREFIX){
-        win32 {
-            CRYPTOPP_PREFIX = M:\Projects\cryptopp
-        }
-        unix:!mac {
-            CRYPTOPP_PREFIX = /home/bob/projects/cryptopp/x86_64
-        }
-    }
-
-    # from a security standpoint, Crypt++ is preferrable to
-    # SimpleCrypt (as SimpleCrypt is preferrable to nothing
-    # at all)...
-
-    DEFINES += USE_ENCRYPTION
-    DEFINES += CRYPTOPP
-
-    INCLUDEPATH += $$CRYPTOPP_PREFIX
-
-    win32 {
-        LIBS += -lcryptlib
-        CONFIG(debug, debug|release) {
-            LIBS += -L$$CRYPTOPP_PREFIX\x64\Output\Debug
-        } else {
-            LIBS += -L$$CRYPTOPP_PREFIX\x64\Output\Release
-        }
-    }
-    unix:!mac {
-        # https://stackoverflow.com/questions/6578484/telling-gcc-directly-to-link-a-library-statically
-        LIBS += -l:libcryptopp.a
-        LIBS += -L$$CRYPTOPP_PREFIX
-    }
-}
-
-simplecrypt {
-    # ...however, if you're exchanging clipbaord data
-    # between machines on an isolated network, or you
-    # aren't paranoid enough to use a heavier crypto
-    # solution like AES, then SimpleCrypt's obfuscation
-    # would likely be just fine for you.  This is only
-    # useful for desktop systems (see 'obfuscate' below).
-
-    DEFINES += USE_ENCRYPTION
-    DEFINES += SIMPLECRYPT
-
-    SOURCES += SimpleCrypt.cpp
-    HEADERS += SimpleCrypt.h
-}
-
-obfuscate {
-    # I could not get industrial strength crypto to
-    # function properly across platforms (PC <-> Mobile)
-    # because I just don't fully understand the
-    # nuances, and SimpleCrypt is only useful between
-    # Qt-based systems, so I fell back to using a
-    # home-grown obfuscation algorithm that functions
-    # correctly on all platforms and languages
-
-    DEFINES += USE_ENCRYPTION
-    DEFINES += OBFUSCATION
-}
+include(crypto.pri)
 
 INTERMEDIATE_NAME = intermediate
 MOC_DIR = $$INTERMEDIATE_NAME/moc
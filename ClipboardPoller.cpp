@@ -0,0 +1,268 @@
+#ifdef QT_WIN
+#define WIN32_MEAN_AND_LEAN // necessary to avoid compiler errors
+#include <Windows.h>
+#endif
+#ifdef CLIPNET_XFIXES
+#include <cstdlib>
+#include <xcb/xcb.h>
+#include <xcb/xfixes.h>
+#endif
+
+#include <QHash>
+#include <QCursor>
+#include <QMimeData>
+#include <QGuiApplication>
+#ifdef CLIPNET_XFIXES
+#include <QX11Info>
+#endif
+
+#include "ClipboardPoller.h"
+
+ClipboardPoller::ClipboardPoller(QClipboard* clipboard, TimerWheel* wheel, QObject* parent)
+    : QObject(parent),
+      m_clipboard(clipboard),
+      m_wheel(wheel)
+{
+}
+
+ClipboardPoller::~ClipboardPoller()
+{
+    stop();
+}
+
+bool ClipboardPoller::start()
+{
+    stop();
+
+    // whatever is on the clipboard already is not news
+    rebase();
+
+#ifndef QT_WIN
+    // Wayland (or anything else without an X server) offers nothing to
+    // watch or poll
+    if (QGuiApplication::platformName() != QLatin1String("xcb"))
+        return false;
+
+    if (!m_owned)
+    {
+        if (auto mime_data = m_clipboard->mimeData())
+        {
+            auto formats{mime_data->formats()};
+            auto has_text{formats.contains("text/plain") || formats.contains("text/uri-list")};
+            note_contents(formats, has_text ? mime_data->text() : QString());
+        }
+    }
+#endif
+
+    m_active = true;
+
+#ifdef CLIPNET_XFIXES
+    m_watching = watch_selection(true);
+    if (m_watching)
+        return true;
+#endif
+
+    m_cursor = QCursor::pos();
+    m_interval = min_interval_ms;
+    m_poll = m_wheel->schedule(m_interval, this, [this]() { poll(); });
+    return true;
+}
+
+void ClipboardPoller::stop()
+{
+    if (!m_active)
+        return;
+
+    m_wheel->cancel(m_poll);
+    m_poll = 0;
+
+#ifdef CLIPNET_XFIXES
+    if (m_watching)
+        watch_selection(false);
+    m_watching = false;
+    m_wheel->cancel(m_check);
+    m_check = 0;
+#endif
+
+    m_active = false;
+}
+
+bool ClipboardPoller::note_contents(const QStringList& formats, const QString& text)
+{
+#ifdef QT_WIN
+    Q_UNUSED(formats)
+    Q_UNUSED(text)
+
+    auto sequence{static_cast<quint32>(::GetClipboardSequenceNumber())};
+    auto different{sequence != m_sequence};
+    m_sequence = sequence;
+    return different;
+#else
+    auto joined{formats.join('\n')};
+    auto text_hash{qHash(text)};
+    auto different{m_owned || !m_noted || joined != m_formats || text_hash != m_text_hash};
+
+    m_owned = false;
+    m_noted = true;
+    m_formats = joined;
+    m_text_hash = text_hash;
+#ifdef CLIPNET_XFIXES
+    m_noted_timestamp = m_selection_timestamp;
+#endif
+    return different;
+#endif
+}
+
+void ClipboardPoller::rebase()
+{
+#ifdef QT_WIN
+    m_sequence = static_cast<quint32>(::GetClipboardSequenceNumber());
+#else
+    // whatever is copied next is news, even if it matches what was there
+    // before our write
+    m_owned = m_clipboard->ownsClipboard();
+    m_noted = false;
+#ifdef CLIPNET_XFIXES
+    m_noted_timestamp = m_selection_timestamp;
+#endif
+#endif
+}
+
+void ClipboardPoller::poll()
+{
+    auto cursor{QCursor::pos()};
+    auto active{cursor != m_cursor};
+    m_cursor = cursor;
+
+    if (changed())
+    {
+        m_interval = min_interval_ms;
+        emit signal_changed();
+    }
+    else if (active)
+        m_interval = min_interval_ms;
+    else
+        m_interval = qMin(m_interval * 2, max_interval_ms);
+
+    m_poll = m_wheel->schedule(m_interval, this, [this]() { poll(); });
+}
+
+bool ClipboardPoller::changed() const
+{
+#ifdef QT_WIN
+    return static_cast<quint32>(::GetClipboardSequenceNumber()) != m_sequence;
+#else
+    // our own data stays ours until another application takes the clipboard
+    if (m_clipboard->ownsClipboard())
+        return false;
+    if (m_owned || !m_noted)
+        return true;
+
+    auto mime_data{m_clipboard->mimeData()};
+    if (!mime_data)
+        return false;
+
+    auto formats{mime_data->formats()};
+    if (formats.join('\n') != m_formats)
+        return true;
+
+    // the same formats from the same owner; only the content can tell
+    auto has_text{formats.contains("text/plain") || formats.contains("text/uri-list")};
+    return qHash(has_text ? mime_data->text() : QString()) != m_text_hash;
+#endif
+}
+
+#ifdef CLIPNET_XFIXES
+
+bool ClipboardPoller::watch_selection(bool enable)
+{
+    if (!QX11Info::isPlatformX11())
+        return false;
+
+    auto connection{QX11Info::connection()};
+
+    if (!m_xfixes_event)
+    {
+        auto extension{xcb_get_extension_data(connection, &xcb_xfixes_id)};
+        if (!extension || !extension->present)
+            return false;
+
+        // the version must be negotiated before any other XFixes request
+        auto version{xcb_xfixes_query_version_reply(connection, xcb_xfixes_query_version(connection, 1, 0), nullptr)};
+        if (!version)
+            return false;
+        ::free(version);
+
+        auto atom{xcb_intern_atom_reply(connection, xcb_intern_atom(connection, 0, 9, "CLIPBOARD"), nullptr)};
+        if (!atom)
+            return false;
+        m_clipboard_atom = atom->atom;
+        ::free(atom);
+
+        m_root = QX11Info::appRootWindow();
+        m_xfixes_event = static_cast<uint8_t>(extension->first_event + XCB_XFIXES_SELECTION_NOTIFY);
+    }
+
+    uint32_t mask{0};
+    if (enable)
+        mask = XCB_XFIXES_SELECTION_EVENT_MASK_SET_SELECTION_OWNER | XCB_XFIXES_SELECTION_EVENT_MASK_SELECTION_WINDOW_DESTROY |
+               XCB_XFIXES_SELECTION_EVENT_MASK_SELECTION_CLIENT_CLOSE;
+    xcb_xfixes_select_selection_input(connection, m_root, m_clipboard_atom, mask);
+    xcb_flush(connection);
+
+    if (enable)
+        QCoreApplication::instance()->installNativeEventFilter(this);
+    else
+        QCoreApplication::instance()->removeNativeEventFilter(this);
+
+    return true;
+}
+
+bool ClipboardPoller::nativeEventFilter(const QByteArray& event_type, void* message, long* result)
+{
+    Q_UNUSED(result)
+
+    if (!m_xfixes_event || event_type != "xcb_generic_event_t")
+        return false;
+
+    auto event{static_cast<xcb_generic_event_t*>(message)};
+    if ((event->response_type & ~0x80) != m_xfixes_event)
+        return false;
+
+    // QClipboard watches the same changes on its own window; both
+    // notifications of a change carry the same timestamp
+    auto notify{reinterpret_cast<xcb_xfixes_selection_notify_event_t*>(event)};
+    if (notify->selection != m_clipboard_atom || notify->selection_timestamp == m_selection_timestamp)
+        return false;
+
+    m_selection_timestamp = notify->selection_timestamp;
+
+    // QClipboard gets its chance to report the change first
+    if (!m_wheel->is_pending(m_check))
+        m_check = m_wheel->schedule(min_interval_ms, this, [this]() { check_selection(); });
+
+    // the event is Qt's to handle as well
+    return false;
+}
+
+void ClipboardPoller::check_selection()
+{
+    // our own data stays ours until another application takes the
+    // clipboard, and a change that was read already is not news
+    if (m_clipboard->ownsClipboard() || m_noted_timestamp == m_selection_timestamp)
+        return;
+
+    emit signal_changed();
+}
+
+#else
+
+bool ClipboardPoller::nativeEventFilter(const QByteArray& event_type, void* message, long* result)
+{
+    Q_UNUSED(event_type)
+    Q_UNUSED(message)
+    Q_UNUSED(result)
+    return false;
+}
+
+#endif
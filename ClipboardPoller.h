@@ -0,0 +1,115 @@
+#pragma once
+
+#include <QPoint>
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QClipboard>
+#include <QStringList>
+#include <QAbstractNativeEventFilter>
+
+#include "TimerWheel.h"
+
+// Catches the clipboard changes that QClipboard::dataChanged() misses (on
+// Linux, copies from Google Docs in a browser are the usual culprits).
+//
+// The clipboard's content is only read once a cheap signal says it has
+// changed.  On Windows that signal is the clipboard sequence number, which
+// is polled every min_interval_ms while the pointer is moving, since that
+// is when copies are made; the interval doubles with every quiet poll up
+// to max_interval_ms, so an idle desktop costs a poll every few seconds.
+//
+// On X11 nothing is polled when the build has XFixes (CLIPNET_XFIXES,
+// set when Qt's x11extras module is available): the X server reports every
+// change of the clipboard's owner through the XFixes extension, including
+// an owner taking the clipboard again for a new copy.  Shortly after each
+// one, the change is reported unless QClipboard already had it read.
+// Without XFixes, the clipboard is polled on the same schedule as on
+// Windows; a poll checks whether we own the clipboard and compares the
+// formats on offer, and only when neither tells it anything reads the
+// text to compare its hash.  Wayland compositors announce every new
+// selection to the focused client, and offer nothing to poll (nor the
+// pointer position the interval depends on), so there the poller does
+// not start and the notifications are relied on.
+//
+// The owner reports what it reads from the clipboard through
+// note_contents(), whichever way the change was detected, and calls
+// rebase() after writing to the clipboard itself; a change is therefore
+// acted on once, and our own writes are never reported.
+
+class ClipboardPoller : public QObject, public QAbstractNativeEventFilter
+{
+    Q_OBJECT
+
+public:
+    static constexpr int min_interval_ms{250};
+    static constexpr int max_interval_ms{4000};
+
+public:
+    ClipboardPoller(QClipboard* clipboard, TimerWheel* wheel, QObject* parent = nullptr);
+    ~ClipboardPoller();
+
+    /*!
+    Start watching for clipboard changes.
+
+    \returns A Boolean true if this platform offers something to watch.
+    */
+    bool start();
+    void stop();
+
+    bool is_active() const { return m_active; }
+
+    /*!
+    Take what was just read from the clipboard as its current contents.
+
+    \param formats The formats on offer.
+    \param text The plain text on offer, if any.
+    \returns A Boolean true if the contents differ from those last noted.
+    */
+    bool note_contents(const QStringList& formats, const QString& text);
+
+    // the clipboard was just written by us
+    void rebase();
+
+    bool nativeEventFilter(const QByteArray& event_type, void* message, long* result) override;
+
+signals:
+    void signal_changed();
+
+private: // methods
+    void poll();
+    bool changed() const;
+#ifdef CLIPNET_XFIXES
+    bool watch_selection(bool enable);
+    void check_selection();
+#endif
+
+private: // data members
+    QClipboard* m_clipboard{nullptr};
+    bool m_active{false};
+
+    TimerWheel* m_wheel{nullptr};
+
+    TimerWheel::timer_id_t m_poll{0};   // 0 while changes are watched instead
+    int m_interval{min_interval_ms};
+    QPoint m_cursor;
+
+#ifdef QT_WIN
+    quint32 m_sequence{0};
+#else
+#ifdef CLIPNET_XFIXES
+    bool m_watching{false};
+    uint8_t m_xfixes_event{0};      // the event code of XFixes selection notifications
+    uint32_t m_clipboard_atom{0};
+    uint32_t m_root{0};             // the window our notifications are selected on
+    uint32_t m_selection_timestamp{0};  // of the newest change of owner
+    uint32_t m_noted_timestamp{0};      // of the change the contents were last noted after
+    TimerWheel::timer_id_t m_check{0};
+#endif
+
+    bool m_owned{false};
+    bool m_noted{false};        // m_formats and m_text_hash are valid
+    QString m_formats;
+    uint m_text_hash{0};
+#endif
+};
@@ -0,0 +1,499 @@
+#include <random>
+#include <iostream>
+
+#ifdef OBFUSCATION
+#include <QDate>
+#endif
+#ifdef SIMPLECRYPT
+#include <QDataStream>
+#include <QCryptographicHash>
+#endif
+
+#ifdef CRYPTOPP
+// Crypto++
+#include "aes.h"
+#include "cpu.h"
+#include "gcm.h"
+#include "chachapoly.h"
+#include "sha.h"
+#include "modes.h"
+#include "osrng.h"
+#endif
+
+#ifdef SIMPLECRYPT
+#include "SimpleCrypt.h"
+#endif
+
+#include "CryptoBackend.h"
+
+namespace crypto
+{
+    namespace
+    {
+        // A Backend built from a policy: a struct naming its cipher, the
+        // State its key lives in, and static set_key(), encrypt() and
+        // decrypt() functions over that state.  The policy's functions are
+        // resolved at compile time; only the Backend interface is virtual.
+        template <typename Policy>
+        class PolicyBackend final : public Backend
+        {
+        public:
+            Cipher cipher() const override { return Policy::cipher; }
+
+            void set_key(const QByteArray& key_material) override { Policy::set_key(m_state, key_material); }
+
+            QByteArray encrypt(const uint8_t* data, uint32_t size, bool& success) const override
+            {
+                return Policy::encrypt(m_state, data, size, success);
+            }
+
+            QByteArray decrypt(const uint8_t* data, uint32_t size, bool& success) const override
+            {
+                return Policy::decrypt(m_state, data, size, success);
+            }
+
+        private:
+            typename Policy::State m_state;
+        };
+
+#ifdef OBFUSCATION
+        // I could not get industrial strength crypto to function properly
+        // across platforms (PC <-> Mobile), and SimpleCrypt is only useful
+        // between Qt-based systems, so this home-grown obfuscation exists
+        // because it works the same on all platforms and languages.
+        struct ObfuscationPolicy
+        {
+            static constexpr Cipher cipher{Cipher::obfuscation};
+
+            struct State
+            {
+                QByteArray passphrase;
+            };
+
+            static void set_key(State& state, const QByteArray& key_material) { state.passphrase = key_material; }
+
+            // XOR is its own inverse
+            static QByteArray encrypt(const State& state, const uint8_t* data, uint32_t size, bool& success)
+            {
+                return apply(state, data, size, success);
+            }
+
+            static QByteArray decrypt(const State& state, const uint8_t* data, uint32_t size, bool& success)
+            {
+                return apply(state, data, size, success);
+            }
+
+        private:
+            static QByteArray new_key(const QByteArray& passphrase, int pepper)
+            {
+                static const std::vector<uint8_t> salt{
+                0x2e, 0x24, 0x2c, 0x21, 0x2e, 0x78, 0x59, 0x31,
+                0x4a, 0x58, 0x24, 0x66, 0x78, 0x42, 0x7e, 0x4c,
+                0x77, 0x79, 0x2e, 0x53, 0x30, 0x27, 0x7b, 0x78,
+                0x57, 0x75, 0x44, 0x24, 0x7d, 0x43, 0x3f, 0x79
+                };
+
+                std::vector<uint8_t> local_salt;
+
+                if ((pepper & 0x1) == 1) // odd?
+                {
+                    // walk-swap the bytes
+                    for (size_t i = 1; i < salt.size(); i += 2)
+                    {
+                        local_salt.push_back(salt[i]);
+                        local_salt.push_back(salt[i - 1]);
+                    }
+                }
+                else // rotate
+                {
+                    auto offset = pepper % salt.size();
+                    for (size_t count = 0; count < salt.size(); ++count)
+                    {
+                        local_salt.push_back(salt[offset]);
+                        if (++offset == salt.size())
+                            offset = 0;
+                    }
+                }
+
+                QByteArray key;
+
+                size_t offset = 0;
+                for (int i = 0; i < passphrase.length(); ++i)
+                {
+                    key.push_back(passphrase[i] ^ local_salt[offset]);
+                    if (++offset == local_salt.size())
+                        offset = 0;
+                }
+
+                return key;
+            }
+
+            static QByteArray apply(const State& state, const uint8_t* data, uint32_t size, bool& success)
+            {
+                auto key{new_key(state.passphrase, QDate::currentDate().dayOfYear())};
+
+                success = !key.isEmpty();
+                if (!success)
+                    return QByteArray();
+
+                QByteArray buffer(static_cast<int>(size), 0);
+
+                int offset = 0;
+                for (uint32_t i = 0; i < size; ++i)
+                {
+                    buffer[static_cast<int>(i)] = static_cast<char>(data[i] ^ static_cast<uint8_t>(key[offset]));
+                    if (++offset == key.size())
+                        offset = 0;
+                }
+
+                return buffer;
+            }
+        };
+#endif
+
+#ifdef SIMPLECRYPT
+        // if you're exchanging clipboard data between machines on an
+        // isolated network, SimpleCrypt's obfuscation is likely just fine
+        struct SimpleCryptPolicy
+        {
+            static constexpr Cipher cipher{Cipher::simplecrypt};
+
+            struct State
+            {
+                std::unique_ptr<SimpleCrypt> simplecrypt;
+            };
+
+            static void set_key(State& state, const QByteArray& key_material)
+            {
+                state.simplecrypt.reset(new SimpleCrypt(sixty_four_hash(QString::fromUtf8(key_material))));
+            }
+
+            static QByteArray encrypt(const State& state, const uint8_t* data, uint32_t size, bool& success)
+            {
+                // SimpleCrypt records its last error; work on a copy so callers on
+                // different threads do not share that state
+                SimpleCrypt crypt(*state.simplecrypt);
+                auto encrypted{crypt.encryptToString(QString::fromUtf8(reinterpret_cast<const char*>(data), static_cast<int>(size)))};
+                success = crypt.lastError() == SimpleCrypt::ErrorNoError;
+                return encrypted.toUtf8();
+            }
+
+            static QByteArray decrypt(const State& state, const uint8_t* data, uint32_t size, bool& success)
+            {
+                SimpleCrypt crypt(*state.simplecrypt);
+                auto decrypted{crypt.decryptToString(QString::fromUtf8(reinterpret_cast<const char*>(data), static_cast<int>(size)))};
+                success = crypt.lastError() == SimpleCrypt::ErrorNoError;
+                return decrypted.toUtf8();
+            }
+
+        private:
+            static quint64 sixty_four_hash(const QString& str)
+            {
+                QByteArray hash =
+                    QCryptographicHash::hash(QByteArray::fromRawData(reinterpret_cast<const char*>(str.utf16()), str.length() * 2), QCryptographicHash::Md5);
+                Q_ASSERT(hash.size() == 16);
+                QDataStream stream(hash);
+                quint64 a, b;
+                stream >> a >> b;
+                return a ^ b;
+            }
+        };
+#endif
+
+#ifdef CRYPTOPP
+        const int key_size{32}; // 256 bits (32 * 8)
+
+        /*!
+        Hash the key material, salted, into a 256-bit key.  Each cipher
+        passes its own label, so no two ciphers ever share a key.
+
+        \param key_material The passphrase or key file contents.
+        \param label Separates the keys of different ciphers; the CFB key predates it and has none.
+        \param key Receives key_size bytes.
+        */
+        void derive_key(const QByteArray& key_material, const QByteArray& label, CryptoPP::byte* key)
+        {
+            static const std::vector<uint8_t> salt{'d', '5', 'y', 'N', '+', '/', '?', '/', ')', 'e', 'j', 'z', 'O', '9', 'Q'};
+
+            CryptoPP::SHA256 hash;
+            hash.Update(salt.data(), salt.size());
+            hash.Update(reinterpret_cast<const CryptoPP::byte*>(key_material.constData()), static_cast<size_t>(key_material.size()));
+            hash.Update(reinterpret_cast<const CryptoPP::byte*>(label.constData()), static_cast<size_t>(label.size()));
+            hash.Final(key);
+        }
+
+        // AES in CFB mode for simplicity.  It is what this build's history
+        // store is encrypted with, so it is kept as it was: same key, same
+        // (deterministic) IV, and no authentication.
+        struct AesCfbPolicy
+        {
+            static constexpr Cipher cipher{Cipher::aes_cfb};
+
+            struct State
+            {
+                CryptoPP::byte iv[CryptoPP::AES::BLOCKSIZE]{0};
+
+                // the key schedule, expanded once; CFB runs the block
+                // cipher forwards in both directions, so this serves
+                // decryption too
+                CryptoPP::AES::Encryption schedule;
+            };
+
+            static void set_key(State& state, const QByteArray& key_material)
+            {
+                // the IV must start the same on all platforms, otherwise
+                // decryption across cryptographic providers WILL NOT WORK!
+                std::minstd_rand rand_generator(0xC0FFEE);
+                for (auto& crypto_val : state.iv)
+                    crypto_val = static_cast<uint8_t>(rand_generator() >> 16);
+
+                CryptoPP::byte key[key_size];
+                derive_key(key_material, QByteArray(), key);
+                state.schedule.SetKey(key, sizeof(key));
+            }
+
+            static QByteArray encrypt(const State& state, const uint8_t* data, uint32_t size, bool& success)
+            {
+                // a copy of the schedule per call keeps concurrent calls
+                // apart without expanding the key again
+                auto schedule{state.schedule};
+                CryptoPP::CFB_Mode_ExternalCipher::Encryption encryption(schedule, state.iv);
+                return process(encryption, data, size, success);
+            }
+
+            static QByteArray decrypt(const State& state, const uint8_t* data, uint32_t size, bool& success)
+            {
+                auto schedule{state.schedule};
+                CryptoPP::CFB_Mode_ExternalCipher::Decryption decryption(schedule, state.iv);
+                return process(decryption, data, size, success);
+            }
+
+        private:
+            static QByteArray process(CryptoPP::StreamTransformation& transformation, const uint8_t* data, uint32_t size, bool& success)
+            {
+                success = true;
+
+                QByteArray out_buffer(static_cast<int>(size), Qt::Uninitialized);
+
+                try
+                {
+                    transformation.ProcessData(reinterpret_cast<CryptoPP::byte*>(out_buffer.data()), data, size);
+                }
+                catch (const CryptoPP::Exception& e)
+                {
+                    std::cerr << e.what() << std::endl;
+                    success = false;
+                }
+
+                return out_buffer;
+            }
+        };
+
+        // An authenticated cipher from Crypto++: a payload is a random
+        // nonce, the ciphertext and the tag.  A payload that was altered,
+        // or produced with another key, fails to decrypt instead of
+        // decrypting to garbage.
+        template <typename Mode, Cipher id>
+        struct AeadPolicy
+        {
+            static constexpr Cipher cipher{id};
+
+            static constexpr int nonce_size{12};
+            static constexpr int tag_size{16};
+
+            struct State
+            {
+                // keyed once; each call works on a copy, which the nonce
+                // then resynchronizes, so calls on different threads
+                // never share cipher state
+                typename Mode::Encryption encryption;
+                typename Mode::Decryption decryption;
+            };
+
+            static void set_key(State& state, const QByteArray& key_material)
+            {
+                CryptoPP::byte key[key_size];
+                derive_key(key_material, QByteArray("ClipNet/") + name(id).toLatin1(), key);
+
+                // the modes refuse a key without a nonce; each call
+                // resynchronizes with its own anyway
+                const CryptoPP::byte nonce[nonce_size]{0};
+                state.encryption.SetKeyWithIV(key, sizeof(key), nonce, nonce_size);
+                state.decryption.SetKeyWithIV(key, sizeof(key), nonce, nonce_size);
+            }
+
+            static QByteArray encrypt(const State& state, const uint8_t* data, uint32_t size, bool& success)
+            {
+                // random 96-bit nonces are safe for far more messages than
+                // a clipboard will ever produce under one passphrase
+                thread_local CryptoPP::AutoSeededRandomPool rng;
+
+                success = true;
+
+                QByteArray out_buffer(nonce_size + static_cast<int>(size) + tag_size, Qt::Uninitialized);
+                auto nonce{reinterpret_cast<CryptoPP::byte*>(out_buffer.data())};
+                auto ciphertext{nonce + nonce_size};
+
+                try
+                {
+                    rng.GenerateBlock(nonce, nonce_size);
+
+                    auto encryption{state.encryption};
+                    encryption.EncryptAndAuthenticate(ciphertext, ciphertext + size, tag_size, nonce, nonce_size, nullptr, 0, data, size);
+                }
+                catch (const CryptoPP::Exception& e)
+                {
+                    std::cerr << e.what() << std::endl;
+                    success = false;
+                }
+
+                return out_buffer;
+            }
+
+            static QByteArray decrypt(const State& state, const uint8_t* data, uint32_t size, bool& success)
+            {
+                success = false;
+                if (size < static_cast<uint32_t>(nonce_size + tag_size))
+                    return QByteArray();
+
+                auto message_size{size - nonce_size - tag_size};
+                QByteArray out_buffer(static_cast<int>(message_size), Qt::Uninitialized);
+
+                try
+                {
+                    auto decryption{state.decryption};
+                    success = decryption.DecryptAndVerify(reinterpret_cast<CryptoPP::byte*>(out_buffer.data()),
+                                                          data + nonce_size + message_size, tag_size,
+                                                          data, nonce_size,
+                                                          nullptr, 0,
+                                                          data + nonce_size, message_size);
+                }
+                catch (const CryptoPP::Exception& e)
+                {
+                    std::cerr << e.what() << std::endl;
+                    success = false;
+                }
+
+                return success ? out_buffer : QByteArray();
+            }
+        };
+
+        // Crypto++ uses AES-NI and carry-less multiplication when the CPU has them
+        using AesGcmPolicy = AeadPolicy<CryptoPP::GCM<CryptoPP::AES>, Cipher::aes_gcm>;
+
+        // only adds, rotations and XORs, which Crypto++ runs on SSE2, AVX2
+        // or NEON as the CPU allows; it needs no AES instructions to keep up
+        // with the network
+        using ChaChaPolicy = AeadPolicy<CryptoPP::ChaCha20Poly1305, Cipher::chacha20_poly1305>;
+#endif
+    } // namespace
+
+    backend_ptr_t make_backend(Cipher cipher)
+    {
+        switch (cipher)
+        {
+#ifdef OBFUSCATION
+            case Cipher::obfuscation:
+                return backend_ptr_t(new PolicyBackend<ObfuscationPolicy>());
+#endif
+#ifdef SIMPLECRYPT
+            case Cipher::simplecrypt:
+                return backend_ptr_t(new PolicyBackend<SimpleCryptPolicy>());
+#endif
+#ifdef CRYPTOPP
+            case Cipher::aes_cfb:
+                return backend_ptr_t(new PolicyBackend<AesCfbPolicy>());
+            case Cipher::aes_gcm:
+                return backend_ptr_t(new PolicyBackend<AesGcmPolicy>());
+            case Cipher::chacha20_poly1305:
+                return backend_ptr_t(new PolicyBackend<ChaChaPolicy>());
+#endif
+            default:
+                return backend_ptr_t();
+        }
+    }
+
+    std::vector<Cipher> available()
+    {
+        std::vector<Cipher> ciphers;
+#ifdef OBFUSCATION
+        ciphers.push_back(Cipher::obfuscation);
+#endif
+#ifdef SIMPLECRYPT
+        ciphers.push_back(Cipher::simplecrypt);
+#endif
+#ifdef CRYPTOPP
+        ciphers.push_back(Cipher::aes_cfb);
+        ciphers.push_back(Cipher::aes_gcm);
+        ciphers.push_back(Cipher::chacha20_poly1305);
+#endif
+        return ciphers;
+    }
+
+    Cipher fastest()
+    {
+#ifdef CRYPTOPP
+        // AES in software is several times slower than ChaCha20, which is
+        // the reverse of how they compare with AES instructions
+        return has_aes_hardware() ? Cipher::aes_gcm : Cipher::chacha20_poly1305;
+#else
+        auto ciphers{available()};
+        return ciphers.empty() ? Cipher::none : ciphers.back();
+#endif
+    }
+
+    Cipher stored()
+    {
+#if defined(CRYPTOPP)
+        return fastest();
+#elif defined(SIMPLECRYPT)
+        return Cipher::simplecrypt;
+#else
+        return Cipher::none;
+#endif
+    }
+
+    bool has_aes_hardware()
+    {
+#if defined(CRYPTOPP) && (CRYPTOPP_BOOL_X86 || CRYPTOPP_BOOL_X32 || CRYPTOPP_BOOL_X64)
+        return CryptoPP::HasAESNI();
+#elif defined(CRYPTOPP) && (CRYPTOPP_BOOL_ARM32 || CRYPTOPP_BOOL_ARMV8)
+        return CryptoPP::HasAES();
+#else
+        return false;
+#endif
+    }
+
+    QString name(Cipher cipher)
+    {
+        switch (cipher)
+        {
+            case Cipher::obfuscation:
+                return "obfuscation";
+            case Cipher::simplecrypt:
+                return "simplecrypt";
+            case Cipher::aes_cfb:
+                return "aes-cfb";
+            case Cipher::aes_gcm:
+                return "aes-gcm";
+            case Cipher::chacha20_poly1305:
+                return "chacha20-poly1305";
+            default:
+                return "none";
+        }
+    }
+
+    Cipher from_name(const QString& name)
+    {
+        auto lc{name.toLower()};
+        if (lc == "auto" || lc.isEmpty())
+            return fastest();
+
+        for (auto cipher : {Cipher::obfuscation, Cipher::simplecrypt, Cipher::aes_cfb, Cipher::aes_gcm, Cipher::chacha20_poly1305})
+        {
+            if (lc == crypto::name(cipher))
+                return cipher;
+        }
+        return Cipher::none;
+    }
+} // namespace crypto
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include <QString>
+#include <QByteArray>
+
+// The ciphers Secure can protect payloads with.
+//
+// Each cipher the build links (CONFIG += cryptopp, simplecrypt and/or
+// obfuscate; they no longer exclude each other) is a Backend behind the
+// same small interface.  Every packet header names the cipher of its
+// payload, so a member decrypts whatever its peers chose to send with,
+// and the cipher used for sending can be chosen when joining rather than
+// when building.  By default each machine sends with the fastest
+// authenticated cipher its CPU supports.
+
+namespace crypto
+{
+    // carried in the packet header; values are never reused
+    enum class Cipher : uint8_t
+    {
+        none,
+        obfuscation,        // the day-of-year XOR; interoperates with non-Qt clients
+        simplecrypt,        // SimpleCrypt; only interoperates with Qt-based clients
+        aes_cfb,            // Crypto++ AES-256 in CFB mode, with a fixed IV; unauthenticated
+        aes_gcm,            // Crypto++ AES-256-GCM with a random nonce per message
+        chacha20_poly1305,  // Crypto++ ChaCha20-Poly1305, likewise; fast without AES hardware
+    };
+
+    // the largest value a packet header may name; anything above it is
+    // from a newer build (or forged) and must not be cast to a Cipher
+    constexpr uint32_t max_cipher{static_cast<uint32_t>(Cipher::chacha20_poly1305)};
+
+    class Backend
+    {
+    public:
+        virtual ~Backend() = default;
+
+        virtual Cipher cipher() const = 0;
+
+        /*!
+        Derive this cipher's key.  The ciphers differ in how they do it, so
+        they are all handed the same material.
+
+        \param key_material The passphrase, or the contents of the key file it names.
+        */
+        virtual void set_key(const QByteArray& key_material) = 0;
+
+        /*!
+        Encrypt or decrypt a buffer.  Once the key is set, both may be
+        called from several threads at once.
+
+        \param data The bytes to be processed.
+        \param size The number of bytes at data.
+        \param success Set to false if the data could not be processed (for an AEAD, if it was not authentic).
+        \returns The processed bytes.
+        */
+        virtual QByteArray encrypt(const uint8_t* data, uint32_t size, bool& success) const = 0;
+        virtual QByteArray decrypt(const uint8_t* data, uint32_t size, bool& success) const = 0;
+    };
+
+    using backend_ptr_t = std::unique_ptr<Backend>;
+
+    /*!
+    \param cipher The cipher wanted.
+    \returns A Backend for it without a key, or nullptr if the build does not include it.
+    */
+    backend_ptr_t make_backend(Cipher cipher);
+
+    // the ciphers this build includes, weakest first (the enumeration's order)
+    std::vector<Cipher> available();
+
+    // the cipher to send with when none is configured: the fastest
+    // authenticated one on this CPU, else the strongest available
+    Cipher fastest();
+
+    // the cipher data at rest is sealed with: the authenticated one the
+    // CPU prefers, so corruption is detected, else SimpleCrypt, else
+    // Cipher::none; obfuscation's key changes with the date, so a file
+    // sealed with it would be unreadable the next day
+    Cipher stored();
+
+    // whether the CPU has AES instructions Crypto++ uses
+    bool has_aes_hardware();
+
+    QString name(Cipher cipher);
+
+    /*!
+    \param name A cipher name as returned by name(), or "auto".
+    \returns The named cipher, fastest() for "auto", or Cipher::none if the name is unknown.
+    */
+    Cipher from_name(const QString& name);
+} // namespace crypto
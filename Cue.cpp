@@ -10,6 +10,7 @@
 #include <QHBoxLayout>
 #include <QGuiApplication>
 #include <QPropertyAnimation>
+#include <QtConcurrent/QtConcurrentRun>
 
 #include "Cue.h"
 
@@ -21,22 +22,22 @@ static ma_engine mini_engine;
 static ma_sound cue_sound;
 #endif
 
-Cue::Cue(const QString cue_sound_file, QWidget* parent) : QWidget{parent}
+// how long the audio device is kept open after the last audio cue
+static const int audio_idle_ms = 2 * 60 * 1000;
+
+Cue::Cue(TimerWheel* wheel, const QString cue_sound_file, QWidget* parent)
+    : QWidget{parent},
+      m_cue_sound_file(cue_sound_file),
+      m_wheel(wheel),
+      m_open_animation(this, "geometry"),
+      m_close_animation(this, "geometry")
 {
     setWindowFlags(Qt::Tool | Qt::FramelessWindowHint | Qt::WindowStaysOnTopHint);
     // setAttribute(Qt::WA_TranslucentBackground);
     setWindowOpacity(0.65);
 
-    // initialize audio playback
-#if defined(QT_LINUX)
-    (void)ma_engine_init(nullptr, &mini_engine);
-
-    auto result = ma_sound_init_from_file(&mini_engine,
-                                          cue_sound_file.toLatin1().constData(),
-                                          MA_SOUND_FLAG_DECODE,
-                                          nullptr, nullptr, &cue_sound);
-    m_audio_available = (result == MA_SUCCESS);
-#endif
+    // audio playback is initialized on demand (see start_audio())
+    connect(&m_audio_watcher, &QFutureWatcher<bool>::finished, this, &Cue::slot_audio_transition_finished);
 
     // initialize visual formatting
 
@@ -69,16 +70,156 @@ Cue::Cue(const QString cue_sound_file, QWidget* parent) : QWidget{parent}
     auto left = (geom.width() - 500) / 2;
     auto top = (geom.height() - 75) / 2;
     setGeometry(left, top, 500, 75);
+
+    // the animations live as long as we do, so a burst of notifications
+    // allocates nothing
+    m_open_animation.setEasingCurve(QEasingCurve::OutQuad);
+    m_open_animation.setDuration(50);
+    connect(&m_open_animation, &QPropertyAnimation::finished, this, &Cue::slot_opened);
+
+    m_close_animation.setEasingCurve(QEasingCurve::OutQuad);
+    m_close_animation.setDuration(50);
+    connect(&m_close_animation, &QPropertyAnimation::finished, this, &Cue::slot_closed);
 }
 
 Cue::~Cue()
 {
 #if defined(QT_LINUX)
-    ma_sound_uninit(&cue_sound);
-    ma_engine_uninit(&mini_engine);
+    m_audio_watcher.waitForFinished();
+
+    // a start may have completed without us having heard about it yet
+    bool loaded = (m_audio_state == AudioState::Ready) ||
+                  (m_audio_state == AudioState::Starting && m_audio_watcher.result());
+    if(loaded)
+    {
+        ma_sound_uninit(&cue_sound);
+        ma_engine_uninit(&mini_engine);
+    }
+#endif
+}
+
+void Cue::slot_set_audio_enabled(bool enabled)
+{
+    if(enabled == m_audio_enabled)
+        return;
+
+    m_audio_enabled = enabled;
+    m_audio_failed = false;
+
+    // the engine is started by the first cue (see slot_trigger_audio()),
+    // so a cold start never touches the audio stack
+    if(!enabled)
+    {
+        m_play_pending = false;
+        m_wheel->cancel(m_audio_idle_timer);
+        m_audio_idle_timer = 0;
+        release_audio();
+    }
+}
+
+void Cue::start_audio()
+{
+#if defined(QT_LINUX)
+    if(m_audio_state != AudioState::Released || m_audio_failed)
+        return;
+
+    m_audio_state = AudioState::Starting;
+
+    // opening the device and decoding the sound both take a while
+    auto file_name = m_cue_sound_file.toLocal8Bit();
+    m_audio_watcher.setFuture(QtConcurrent::run([file_name]() {
+        if(ma_engine_init(nullptr, &mini_engine) != MA_SUCCESS)
+            return false;
+
+        auto result = ma_sound_init_from_file(&mini_engine,
+                                              file_name.constData(),
+                                              MA_SOUND_FLAG_DECODE,
+                                              nullptr, nullptr, &cue_sound);
+        if(result != MA_SUCCESS)
+        {
+            ma_engine_uninit(&mini_engine);
+            return false;
+        }
+
+        return true;
+    }));
+#endif
+}
+
+void Cue::release_audio()
+{
+#if defined(QT_LINUX)
+    // a start in flight is released when it completes
+    if(m_audio_state != AudioState::Ready)
+        return;
+
+    m_audio_state = AudioState::Releasing;
+    m_audio_available = false;
+
+    m_audio_watcher.setFuture(QtConcurrent::run([]() {
+        ma_sound_uninit(&cue_sound);
+        ma_engine_uninit(&mini_engine);
+        return false;
+    }));
 #endif
 }
 
+void Cue::slot_audio_transition_finished()
+{
+    if(m_audio_state == AudioState::Starting)
+    {
+        m_audio_available = m_audio_watcher.result();
+        m_audio_state = m_audio_available ? AudioState::Ready : AudioState::Released;
+        m_audio_failed = !m_audio_available;
+    }
+    else if(m_audio_state == AudioState::Releasing)
+        m_audio_state = AudioState::Released;
+
+    // catch up with whatever was asked of us in the meantime
+    if(m_audio_state == AudioState::Ready)
+    {
+        if(!m_audio_enabled)
+            release_audio();
+        else
+        {
+            if(m_play_pending)
+                play_audio();
+            restart_audio_idle();
+        }
+    }
+    else if(m_play_pending && m_audio_enabled && !m_audio_failed)
+        start_audio();
+    else
+        m_play_pending = false;
+}
+
+void Cue::play_audio()
+{
+    m_play_pending = false;
+#if defined(QT_LINUX)
+    if(m_audio_available)
+        ma_sound_start(&cue_sound);
+#endif
+}
+
+void Cue::restart_audio_idle()
+{
+    m_wheel->cancel(m_audio_idle_timer);
+    m_audio_idle_timer = m_wheel->schedule(audio_idle_ms, this, [this]() {
+        m_audio_idle_timer = 0;
+        release_audio();
+    });
+}
+
+void Cue::restart_hold()
+{
+    m_wheel->cancel(m_hold_timer);
+    m_hold_timer = m_wheel->schedule(1000, this, [this]() {
+        m_hold_timer = 0;
+        slot_hold_expired();
+    });
+}
+
 #if defined(QT_LINUX)
 #if 0
 static void my_end_callback(void* pUserData, ma_sound* pSound)
@@ -92,8 +233,18 @@ static void my_end_callback(void* pUserData, ma_sound* pSound)
 
 void Cue::slot_trigger_audio()
 {
+    if(m_audio_state == AudioState::Ready)
+    {
+        play_audio();
+        restart_audio_idle();
+    }
+    else
+    {
+        m_play_pending = true;
+        start_audio();
+    }
+
 #if defined(QT_LINUX)
-    ma_sound_start(&cue_sound);
 
 #if 0
     // MA_API ma_result ma_sound_set_end_callback(ma_sound* pSound, ma_sound_end_proc callback, void* pUserData);
@@ -112,6 +263,33 @@ const float fWidgetHeight = 0.035;
 
 void Cue::slot_trigger_visual(const QString display_text)
 {
+    m_display_text = display_text;
+    ++m_burst_count;
+
+    switch (m_visual_state)
+    {
+        case VisualState::Opening:
+            // slot_opened() shows whatever is newest
+            return;
+
+        case VisualState::Showing:
+            update_label();
+            restart_hold();
+            return;
+
+        case VisualState::Closing:
+            // reopen from wherever the close got to
+            m_close_animation.stop();
+            m_open_animation.setStartValue(geometry());
+            m_open_animation.setEndValue(m_target_r);
+            m_visual_state = VisualState::Opening;
+            m_open_animation.start();
+            return;
+
+        case VisualState::Hidden:
+            break;
+    }
+
     m_textlabel->setText(QString());
 
     // https://doc.qt.io/qt-5/qparallelanimationgroup.html#details
@@ -132,40 +310,12 @@ void Cue::slot_trigger_visual(const QString display_text)
     m_initial_r = QRect(actual_width / 2, y, 0, widget_height);
     setGeometry(m_initial_r);
 
-    QPropertyAnimation* animation = new QPropertyAnimation(this, "geometry");
-    animation->setStartValue(m_initial_r);
-    animation->setEndValue(m_target_r);
-    animation->setEasingCurve(QEasingCurve::OutQuad);
-    animation->setDuration(50);
-
     // open the pop-up
-    connect(animation, &QPropertyAnimation::finished, this, [this, display_text](){
-        // once it's fully open, place the text
-        if(display_text.length() > 20)
-            m_textlabel->setText(QString("%1...").arg(display_text.left(17)));
-        else
-            m_textlabel->setText(display_text);
-
-        // wait a resonable amount of time
-        QTimer::singleShot(1000, this, [this]() {
-            m_textlabel->setText(QString());
+    m_open_animation.setStartValue(m_initial_r);
+    m_open_animation.setEndValue(m_target_r);
 
-            // and then close it
-            QPropertyAnimation* animation = new QPropertyAnimation(this, "geometry");
-            animation->setStartValue(m_target_r);
-            animation->setEndValue(m_initial_r);
-            animation->setEasingCurve(QEasingCurve::OutQuad);
-            animation->setDuration(50);
-
-            connect(animation, &QPropertyAnimation::finished, this, [this](){
-                hide();
-            });
-
-            animation->start();
-        });
-    });
-
-    animation->start();
+    m_visual_state = VisualState::Opening;
+    m_open_animation.start();
     show();
 
 #if 0
@@ -184,6 +334,47 @@ void Cue::slot_trigger_visual(const QString display_text)
 #endif
 }
 
+void Cue::slot_opened()
+{
+    // once it's fully open, place the text...
+    m_visual_state = VisualState::Showing;
+    update_label();
+
+    // ...and wait a resonable amount of time
+    restart_hold();
+}
+
+void Cue::slot_hold_expired()
+{
+    m_textlabel->setText(QString());
+
+    // and then close it
+    m_close_animation.setStartValue(geometry());
+    m_close_animation.setEndValue(m_initial_r);
+
+    m_visual_state = VisualState::Closing;
+    m_close_animation.start();
+}
+
+void Cue::slot_closed()
+{
+    hide();
+
+    m_visual_state = VisualState::Hidden;
+    m_burst_count = 0;
+}
+
+void Cue::update_label()
+{
+    auto text = m_display_text.length() > 20 ? QString("%1...").arg(m_display_text.left(17)) : m_display_text;
+
+    // a burst shows the newest copy and how many arrived together
+    if (m_burst_count > 1)
+        text = QString("%1 (%2)").arg(text).arg(m_burst_count);
+
+    m_textlabel->setText(text);
+}
+
 #if 0
 void Cue::slot_check_completion()
 {
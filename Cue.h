@@ -1,15 +1,19 @@
 #pragma once
 
 #include <QWidget>
+#include <QFutureWatcher>
 #include <QLabel>
 #include <QHBoxLayout>
 #include <QSharedPointer>
+#include <QPropertyAnimation>
+
+#include "TimerWheel.h"
 
 class Cue : public QWidget
 {
     Q_OBJECT
 public:
-    explicit Cue(const QString cue_sound_file = "./notify.wav", QWidget* parent = nullptr);
+    explicit Cue(TimerWheel* wheel, const QString cue_sound_file = "./notify.wav", QWidget* parent = nullptr);
     ~Cue();
 
 #if 0
@@ -19,6 +23,7 @@ public:
 signals:
 
 public slots:
+    void    slot_set_audio_enabled(bool enabled);
     void    slot_trigger_audio();
     void    slot_trigger_visual(const QString display_text);
 
@@ -26,9 +31,52 @@ private slots:
 #if 0
     void    slot_check_completion();
 #endif
+    void    slot_audio_transition_finished();
+    void    slot_opened();
+    void    slot_hold_expired();
+    void    slot_closed();
+
+private:
+    // the pop-up is a single, reused widget; a trigger that arrives while
+    // it is on screen updates it rather than starting another one
+    enum class VisualState
+    {
+        Hidden,
+        Opening,
+        Showing,
+        Closing,
+    };
+
+    // the audio engine is only brought up (on a worker thread) once audio
+    // cues are wanted, and is shut down again when they go unused
+    enum class AudioState
+    {
+        Released,
+        Starting,
+        Ready,
+        Releasing,
+    };
+
+    void    start_audio();
+    void    release_audio();
+    void    play_audio();
+
+    void    update_label();
+
+    void    restart_audio_idle();
+    void    restart_hold();
 
 private:
     bool    m_audio_available{false};       // is the audio cue playable?
+    bool    m_audio_enabled{false};         // does the user want audio cues?
+    bool    m_audio_failed{false};          // the engine could not be started; don't keep trying
+    bool    m_play_pending{false};          // play as soon as the engine is up
+
+    QString     m_cue_sound_file;
+    AudioState  m_audio_state{AudioState::Released};
+    QFutureWatcher<bool> m_audio_watcher;
+    TimerWheel* m_wheel{nullptr};
+    TimerWheel::timer_id_t m_audio_idle_timer{0};
 #if 0
     bool    m_audio_complete{false};        // has the audio cue finished playing?
     bool    m_visual_complete{false};       // has the visual cue finsihed playing?
@@ -37,6 +85,14 @@ private:
     QLabel* m_textlabel{nullptr};
 
     QRect   m_initial_r, m_target_r;
+
+    QPropertyAnimation  m_open_animation;
+    QPropertyAnimation  m_close_animation;
+    TimerWheel::timer_id_t m_hold_timer{0};
+
+    VisualState m_visual_state{VisualState::Hidden};
+    QString     m_display_text;                 // the newest text to show
+    int         m_burst_count{0};               // triggers since the pop-up opened
 };
 
 using CuePointer = QSharedPointer<Cue>;
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+
+// On-disk layout of the flight recorder file.  This header is shared with
+// the flightdump tool, so it must stay free of Qt.
+//
+// The file is a FlightHeader followed by 'capacity' FlightRecords used as a
+// ring.  Records are claimed by incrementing 'head'; a record is complete
+// once its 'sequence' field (written last) equals the sequence it was
+// claimed with, plus one.  All values are little-endian.
+
+namespace flight
+{
+    constexpr uint32_t magic{0x52464e43}; // "CNFR"
+    constexpr uint32_t version{1};
+
+    enum class Direction : uint8_t
+    {
+        Outgoing,
+        Incoming,
+    };
+
+    enum class Outcome : uint8_t
+    {
+        Sent,
+        SendFailed,
+        Applied,
+        Malformed,
+        Rejected,
+        DecryptFailed,
+        ParseFailed,
+        Superseded,     // received, but a newer copy was applied instead
+        Abandoned,      // announced by a preview, but the body never arrived
+        CipherRejected, // encrypted with a cipher this build lacks, or below minimum_cipher
+    };
+
+    // what each stage_us slot measured, by direction
+    //   outgoing: snapshot, serialize, encrypt, send
+    //   incoming: verify, decrypt, parse, apply
+    constexpr int stage_count{4};
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t header_size;
+        uint32_t record_size;
+        uint64_t capacity;
+        uint64_t head;          // next sequence to be claimed (updated atomically)
+        uint8_t reserved[32];
+    };
+
+    struct Record
+    {
+        uint64_t sequence;      // claimed sequence + 1; zero means never written
+        int64_t timestamp_ms;   // wall clock, milliseconds since the epoch
+        int32_t peer;           // sender id of the message (ours for outgoing)
+        uint32_t message_id;
+        uint32_t payload_bytes;
+        uint32_t datagram_bytes;
+        uint32_t stage_us[stage_count];
+        Direction direction;
+        Outcome outcome;
+        uint8_t reserved[14];
+    };
+
+    static_assert(sizeof(Header) == 64, "flight::Header must be 64 bytes");
+    static_assert(sizeof(Record) == 64, "flight::Record must be 64 bytes");
+
+    inline const char* name(Outcome outcome)
+    {
+        switch (outcome)
+        {
+            case Outcome::Sent:
+                return "sent";
+            case Outcome::SendFailed:
+                return "send_failed";
+            case Outcome::Applied:
+                return "applied";
+            case Outcome::Malformed:
+                return "malformed";
+            case Outcome::Rejected:
+                return "rejected";
+            case Outcome::DecryptFailed:
+                return "decrypt_failed";
+            case Outcome::ParseFailed:
+                return "parse_failed";
+            case Outcome::Superseded:
+                return "superseded";
+            case Outcome::Abandoned:
+                return "abandoned";
+            case Outcome::CipherRejected:
+                return "cipher_rejected";
+        }
+        return "unknown";
+    }
+} // namespace flight
@@ -0,0 +1,130 @@
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+#include "FlightRecorder.h"
+
+// the head counter lives in the shared mapping; lock-free 64-bit atomics
+// are address-free, so it can be updated in place
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the flight recorder needs lock-free 64-bit atomics");
+
+static std::atomic<uint64_t>* as_atomic(uint64_t* value)
+{
+    return reinterpret_cast<std::atomic<uint64_t>*>(value);
+}
+
+//------------------------------------------------
+// Factory methods
+
+FlightRecorder& FlightRecorder::instance()
+{
+    static FlightRecorder recorder;
+    return recorder;
+}
+
+QString FlightRecorder::default_file_name()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation)).filePath("flight.rec");
+}
+
+//------------------------------------------------
+// Instance methods
+
+FlightRecorder::~FlightRecorder()
+{
+    close();
+}
+
+bool FlightRecorder::open(const QString& file_name, uint64_t capacity)
+{
+    QWriteLocker locker(&m_lock);
+
+    unmap();
+
+    QDir().mkpath(QFileInfo(file_name).absolutePath());
+
+    auto file_size{static_cast<qint64>(sizeof(flight::Header) + capacity * sizeof(flight::Record))};
+
+    m_file.setFileName(file_name);
+    if (!m_file.open(QIODevice::ReadWrite))
+        return false;
+
+    bool reset{m_file.size() != file_size};
+    if (reset && !m_file.resize(file_size))
+    {
+        m_file.close();
+        return false;
+    }
+
+    auto data{m_file.map(0, file_size)};
+    if (!data)
+    {
+        m_file.close();
+        return false;
+    }
+
+    m_header = reinterpret_cast<flight::Header*>(data);
+
+    reset = reset || m_header->magic != flight::magic || m_header->version != flight::version ||
+            m_header->header_size != sizeof(flight::Header) || m_header->record_size != sizeof(flight::Record) ||
+            m_header->capacity != capacity;
+
+    if (reset)
+    {
+        ::memset(data, 0, static_cast<size_t>(file_size));
+
+        m_header->magic = flight::magic;
+        m_header->version = flight::version;
+        m_header->header_size = sizeof(flight::Header);
+        m_header->record_size = sizeof(flight::Record);
+        m_header->capacity = capacity;
+        m_header->head = 0;
+    }
+
+    m_records = reinterpret_cast<flight::Record*>(data + sizeof(flight::Header));
+    return true;
+}
+
+void FlightRecorder::close()
+{
+    QWriteLocker locker(&m_lock);
+
+    unmap();
+}
+
+void FlightRecorder::unmap()
+{
+    if (m_header)
+        m_file.unmap(reinterpret_cast<uchar*>(m_header));
+
+    m_header = nullptr;
+    m_records = nullptr;
+
+    if (m_file.isOpen())
+        m_file.close();
+}
+
+void FlightRecorder::record(const flight::Record& record)
+{
+    // records from several threads only share the atomic head
+    QReadLocker locker(&m_lock);
+
+    if (!m_records)
+        return;
+
+    auto sequence{as_atomic(&m_header->head)->fetch_add(1, std::memory_order_relaxed)};
+    auto& slot{m_records[sequence % m_header->capacity]};
+
+    // invalidate, fill, then publish the sequence last
+    as_atomic(&slot.sequence)->store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    auto sequence_offset{offsetof(flight::Record, timestamp_ms)};
+    ::memcpy(reinterpret_cast<char*>(&slot) + sequence_offset, reinterpret_cast<const char*>(&record) + sequence_offset, sizeof(flight::Record) - sequence_offset);
+
+    as_atomic(&slot.sequence)->store(sequence + 1, std::memory_order_release);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QFile>
+#include <QString>
+#include <QReadWriteLock>
+
+#include "FlightRecord.h"
+
+// A fixed-size, memory-mapped ring file of compact binary sync events, so
+// "the copy never arrived yesterday" can be investigated after the fact.
+// Writing a record is a handful of stores into the mapping; the kernel
+// writes the dirty pages back, so the hot path makes no system calls, and
+// records survive a crash of the process.
+//
+// Records are written concurrently under a shared lock; open() and close()
+// take it exclusively, so no record lands in a mapping being replaced.
+//
+// Decode the file with tools/flightdump.
+
+class FlightRecorder
+{
+public:
+    static FlightRecorder& instance();
+
+    /*!
+    Map (creating or resetting it as needed) the ring file.
+
+    \param file_name The path of the ring file.
+    \param capacity The number of records the ring holds.
+    \returns A Boolean true if the recorder is ready.
+    */
+    bool open(const QString& file_name, uint64_t capacity = 16384);
+    void close();
+
+    bool is_open() const { return m_records != nullptr; }
+
+    /*!
+    Append a record, overwriting the oldest one if the ring is full.  The
+    sequence field is filled in here.  Safe to call from any thread.
+
+    \param record The event to record.
+    */
+    void record(const flight::Record& record);
+
+    static QString default_file_name();
+
+private:
+    FlightRecorder() = default;
+    ~FlightRecorder();
+
+    void unmap();
+
+private: // data members
+    QReadWriteLock m_lock;
+    QFile m_file;
+    flight::Header* m_header{nullptr};
+    flight::Record* m_records{nullptr};
+};
@@ -0,0 +1,892 @@
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QStandardPaths>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include "History.h"
+#include "ClipMimeData.h"
+#include "Representation.h"
+
+// The store is a StoreHeader followed by records, each a RecordHeader and
+// the encoded entry, padded to eight bytes.  'used' in the header is only
+// advanced once a record is complete, so a record torn by a crash is never
+// seen.  Records are never modified after they are written.
+//
+// Each record names the cipher it is sealed with, and so does the first
+// byte of the index file: the authenticated cipher a build prefers
+// depends on the CPU, and a store may outlive the machine it started on.
+
+namespace
+{
+    constexpr uint32_t store_magic{0x53484e43}; // "CNHS"
+    constexpr uint32_t store_version{2};
+
+    constexpr qint64 initial_size{1024 * 1024};
+
+    // dead records are not worth a rewrite until there are this many bytes of them
+    constexpr uint64_t compact_threshold{256 * 1024};
+
+    constexpr int preview_length{60};
+
+    struct StoreHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t used;      // bytes of the file holding complete records, including this header
+        uint64_t next_id;
+        uint8_t reserved[40];
+    };
+
+    // how a record's entry is encoded; stores written before there was a
+    // choice only hold plain records
+    enum RecordFormat : uint32_t
+    {
+        plain_format,   // host, text and HTML, compressed together
+        blocks_format,  // host, an excerpt of the text, and the text and HTML as ClipMimeData::compress() blocks
+    };
+
+    struct RecordHeader
+    {
+        uint32_t size;      // of the encoded entry that follows
+        uint32_t format;    // a RecordFormat
+        uint64_t id;
+        int64_t timestamp;
+        int32_t peer;
+        uint8_t cipher;     // a crypto::Cipher
+        uint8_t padding[3];
+    };
+
+    static_assert(sizeof(StoreHeader) == 64, "StoreHeader must be 64 bytes");
+    static_assert(sizeof(RecordHeader) == 32, "RecordHeader must be 32 bytes");
+
+    uint64_t aligned(uint64_t size)
+    {
+        return (size + 7) & ~uint64_t(7);
+    }
+
+    uint content_hash(const QString& text, const QString& html)
+    {
+        return qHash(html, qHash(text));
+    }
+
+    // encrypt an encoded entry, in builds with encryption
+    bool seal(const secure_ptr_t& security, QByteArray& buffer, uint8_t& cipher)
+    {
+        cipher = static_cast<uint8_t>(crypto::Cipher::none);
+#if defined(USE_ENCRYPTION)
+        if (security)
+        {
+            bool success{false};
+            buffer = security->encrypt(buffer, success);
+            cipher = static_cast<uint8_t>(security->cipher());
+            return success;
+        }
+#else
+        Q_UNUSED(security)
+        Q_UNUSED(buffer)
+#endif
+        return true;
+    }
+
+    bool unseal(const secure_ptr_t& security, uint8_t cipher, QByteArray& buffer)
+    {
+#if defined(USE_ENCRYPTION)
+        if (security)
+        {
+            // a sealed entry must name a cipher this build has; with an
+            // authenticated one, a corrupted entry fails here too
+            if (cipher == static_cast<uint8_t>(crypto::Cipher::none) || cipher > crypto::max_cipher ||
+                !security->supports(static_cast<crypto::Cipher>(cipher)))
+                return false;
+
+            bool success{false};
+            buffer = security->decrypt(buffer, static_cast<crypto::Cipher>(cipher), success);
+            return success;
+        }
+#else
+        Q_UNUSED(security)
+        Q_UNUSED(buffer)
+#endif
+        return cipher == static_cast<uint8_t>(crypto::Cipher::none);
+    }
+} // namespace
+
+//------------------------------------------------
+// Factory methods
+
+QString History::default_file_name()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation)).filePath("history.dat");
+}
+
+QString History::make_preview(const QString& text)
+{
+    QString line;
+    for (const auto& candidate : text.splitRef('\n'))
+    {
+        line = candidate.toString().simplified();
+        if (!line.isEmpty())
+            break;
+    }
+
+    if (line.length() > preview_length)
+        line = line.left(preview_length - 1) + QChar(0x2026);
+    return line;
+}
+
+//------------------------------------------------
+// Instance methods
+
+History::History(QObject* parent) : QObject(parent)
+{
+    connect(&m_load_watcher, &QFutureWatcher<LoadResult>::finished, this, &History::slot_load_finished);
+    connect(&m_compact_watcher, &QFutureWatcher<QString>::finished, this, &History::slot_compact_finished);
+    connect(&m_search_watcher, &QFutureWatcher<SearchResult>::finished, this, &History::slot_search_finished);
+}
+
+History::~History()
+{
+    close();
+}
+
+bool History::open(const QString& file_name, int capacity, const QString& key)
+{
+    close();
+
+    m_file_name = file_name;
+    m_index_file_name = QFileInfo(file_name).dir().filePath(QFileInfo(file_name).completeBaseName() + ".idx");
+    m_key = key;
+    m_capacity = qMax(1, capacity);
+
+#if defined(USE_ENCRYPTION)
+    // the store must stay readable whatever cipher the group chooses, and
+    // from one day to the next
+    if (crypto::stored() == crypto::Cipher::none)
+        return false;
+    m_security = Secure::create(key, crypto::name(crypto::stored()));
+#endif
+
+    QDir().mkpath(QFileInfo(file_name).absolutePath());
+
+    if (!reopen())
+        return false;
+
+    auto header{reinterpret_cast<StoreHeader*>(m_data)};
+    if (header->magic != store_magic || header->version != store_version || header->used < sizeof(StoreHeader) ||
+        header->used > static_cast<uint64_t>(m_mapped_size))
+    {
+        ::memset(header, 0, sizeof(StoreHeader));
+        header->magic = store_magic;
+        header->version = store_version;
+        header->used = sizeof(StoreHeader);
+        header->next_id = 1;
+    }
+
+    // the summaries are rebuilt off the GUI thread; anything appended in
+    // the meantime lands after the region the loader reads
+    m_loaded = false;
+    m_load_watcher.setFuture(QtConcurrent::run(&History::load, m_file_name, m_index_file_name, header->used, m_capacity, m_key));
+
+    return true;
+}
+
+void History::close()
+{
+    m_load_watcher.waitForFinished();
+    m_compact_watcher.waitForFinished();
+    m_search_watcher.waitForFinished();
+    m_search_waiting = false;
+
+    // entries still being encoded are stored before the store goes away
+    while (!m_appending.empty())
+    {
+        m_appending.front()->waitForFinished();
+        slot_append_finished();
+    }
+
+    if (m_data && m_loaded)
+        save_index();
+
+    if (m_data)
+        m_file.unmap(m_data);
+    m_data = nullptr;
+    m_mapped_size = 0;
+
+    if (m_file.isOpen())
+        m_file.close();
+
+    m_entries.clear();
+    m_loaded = false;
+    m_index.clear();
+    m_unindexed.clear();
+    m_security.clear();
+}
+
+bool History::reopen()
+{
+    m_file.setFileName(m_file_name);
+    if (!m_file.open(QIODevice::ReadWrite))
+        return false;
+
+    if (!map(qMax(m_file.size(), initial_size)))
+    {
+        m_file.close();
+        return false;
+    }
+
+    return true;
+}
+
+bool History::map(qint64 size)
+{
+    if (m_data)
+        m_file.unmap(m_data);
+    m_data = nullptr;
+    m_mapped_size = 0;
+
+    if (m_file.size() < size && !m_file.resize(size))
+        return false;
+
+    m_data = m_file.map(0, size);
+    if (!m_data)
+        return false;
+
+    m_mapped_size = size;
+    return true;
+}
+
+bool History::reserve(uint64_t size)
+{
+    auto used{reinterpret_cast<const StoreHeader*>(m_data)->used};
+    if (used + size <= static_cast<uint64_t>(m_mapped_size))
+        return true;
+
+    auto new_size{qMax(static_cast<uint64_t>(m_mapped_size) * 2, aligned(used + size))};
+    return map(static_cast<qint64>(new_size));
+}
+
+void History::append(int peer, const QString& host, const QString& copied_text, const QString& html)
+{
+    if (!m_data)
+        return;
+
+    // deriving the text, compressing and encrypting all grow with the copy,
+    // so they are done off the GUI thread
+    auto watcher{new append_watcher_t(this)};
+    connect(watcher, &append_watcher_t::finished, this, &History::slot_append_finished);
+    m_appending.push_back(watcher);
+
+    watcher->setFuture(QtConcurrent::run(&History::encode, m_security, peer, host, copied_text, html));
+}
+
+void History::append_blocks(int peer, const QString& host, const QString& excerpt, const QByteArray& text_block, const QByteArray& html_block)
+{
+    if (!m_data)
+        return;
+
+    auto watcher{new append_watcher_t(this)};
+    connect(watcher, &append_watcher_t::finished, this, &History::slot_append_finished);
+    m_appending.push_back(watcher);
+
+    auto security{m_security};
+    watcher->setFuture(QtConcurrent::run([security, peer, host, excerpt, text_block, html_block]() {
+        return encode_blocks(security, peer, host, excerpt, text_block, html_block);
+    }));
+}
+
+void History::slot_append_finished()
+{
+    // entries are stored in the order they were appended, however the workers finish
+    while (!m_appending.empty() && m_appending.front()->isFinished())
+    {
+        auto watcher{m_appending.front()};
+        m_appending.pop_front();
+
+        auto encoded{watcher->result()};
+        watcher->deleteLater();
+
+        store(encoded);
+    }
+}
+
+void History::store(const Encoded& encoded)
+{
+    if (!m_data || encoded.data.isEmpty())
+        return;
+
+    // recalling an entry puts it back on the clipboard, which would
+    // otherwise record it all over again
+    if (!m_entries.empty() && m_entries.back().qhash == encoded.qhash && m_entries.back().preview == encoded.preview)
+        return;
+
+    auto record_size{aligned(sizeof(RecordHeader) + static_cast<uint64_t>(encoded.data.size()))};
+    if (!reserve(record_size))
+        return;
+
+    auto header{reinterpret_cast<StoreHeader*>(m_data)};
+    auto offset{header->used};
+
+    Entry entry;
+    entry.id = header->next_id;
+    entry.timestamp = QDateTime::currentMSecsSinceEpoch();
+    entry.peer = encoded.peer;
+    entry.host = encoded.host;
+    entry.preview = encoded.preview;
+    entry.qhash = encoded.qhash;
+    entry.offset = offset;
+
+    auto record{reinterpret_cast<RecordHeader*>(m_data + offset)};
+    ::memset(record, 0, record_size);
+    record->size = static_cast<uint32_t>(encoded.data.size());
+    record->format = encoded.format;
+    record->cipher = encoded.cipher;
+    record->id = entry.id;
+    record->timestamp = entry.timestamp;
+    record->peer = entry.peer;
+    ::memcpy(record + 1, encoded.data.constData(), static_cast<size_t>(encoded.data.size()));
+
+    // publish the record only once it is complete
+    header->next_id = entry.id + 1;
+    header->used = offset + record_size;
+
+    m_entries.push_back(entry);
+
+    if (m_loaded)
+        m_index.add(entry.id, encoded.text);
+    else
+        m_unindexed.emplace_back(entry.id, encoded.text.left(HistoryIndex::indexed_length));
+
+    trim();
+    maybe_compact();
+}
+
+const History::Entry* History::find(uint64_t id) const
+{
+    auto iter{std::lower_bound(m_entries.begin(), m_entries.end(), id, [](const Entry& entry, uint64_t value) { return entry.id < value; })};
+    if (iter == m_entries.end() || iter->id != id)
+        return nullptr;
+    return &*iter;
+}
+
+bool History::content(uint64_t id, Content& content) const
+{
+    if (!m_data)
+        return false;
+
+    auto entry{find(id)};
+    if (!entry)
+        return false;
+
+    auto used{reinterpret_cast<const StoreHeader*>(m_data)->used};
+    if (entry->offset + sizeof(RecordHeader) > used)
+        return false;
+
+    auto record{reinterpret_cast<const RecordHeader*>(m_data + entry->offset)};
+    if (record->id != id || entry->offset + sizeof(RecordHeader) + record->size > used)
+        return false;
+
+    return decode(m_security, record->format, record->cipher, reinterpret_cast<const char*>(record + 1), record->size, content);
+}
+
+void History::search(const QString& query, int limit)
+{
+    if (m_search_watcher.isRunning())
+    {
+        m_search_waiting = true;
+        m_next_query = query;
+        m_next_limit = limit;
+        return;
+    }
+
+    std::vector<Entry> results;
+
+    auto needle{HistoryIndex::fold(query)};
+    if (!m_data || needle.isEmpty() || limit <= 0)
+    {
+        emit signal_searched(query, results);
+        return;
+    }
+
+    if (needle.length() < 3)
+    {
+        // too short to use the index; the previews are a fair stand-in
+        for (auto iter = m_entries.rbegin(); iter != m_entries.rend() && results.size() < static_cast<size_t>(limit); ++iter)
+        {
+            if (HistoryIndex::fold(iter->preview).contains(needle))
+                results.push_back(*iter);
+        }
+        emit signal_searched(query, results);
+        return;
+    }
+
+    std::vector<Entry> candidates;
+    for (auto id : m_index.candidates(query))
+    {
+        if (auto entry = find(id))
+            candidates.push_back(*entry);
+    }
+
+    // decrypting and inflating each candidate grows with the entries, so
+    // they are confirmed off the GUI thread, reading records (which are
+    // never modified) through a handle of their own
+    m_search_watcher.setFuture(QtConcurrent::run(&History::confirm, m_file_name, m_security, query, candidates, limit));
+}
+
+History::SearchResult History::confirm(QString file_name, secure_ptr_t security, QString query, std::vector<Entry> candidates, int limit)
+{
+    SearchResult result;
+    result.query = query;
+
+    QFile file(file_name);
+    if (!file.open(QIODevice::ReadOnly))
+        return result;
+
+    auto needle{HistoryIndex::fold(query)};
+    for (const auto& entry : candidates)
+    {
+        RecordHeader record;
+        if (!file.seek(static_cast<qint64>(entry.offset)) || file.read(reinterpret_cast<char*>(&record), sizeof(record)) != sizeof(record) ||
+            record.id != entry.id)
+            continue;
+
+        auto encoded{file.read(record.size)};
+
+        // the index only covers the text a summary holds
+        Summary summary;
+        if (encoded.size() != static_cast<int>(record.size) || !summarize(security, record.format, record.cipher, encoded.constData(), record.size, summary) ||
+            !HistoryIndex::fold(summary.text).contains(needle))
+            continue;
+
+        result.entries.push_back(entry);
+        if (result.entries.size() >= static_cast<size_t>(limit))
+            break;
+    }
+
+    return result;
+}
+
+void History::slot_search_finished()
+{
+    auto result{m_search_watcher.result()};
+
+    // a newer query makes this result stale
+    if (m_search_waiting)
+    {
+        m_search_waiting = false;
+        search(m_next_query, m_next_limit);
+        return;
+    }
+
+    // entries may have left the history, or moved in it, while the search ran
+    std::vector<Entry> entries;
+    for (const auto& found : result.entries)
+    {
+        if (auto entry = find(found.id))
+            entries.push_back(*entry);
+    }
+
+    emit signal_searched(result.query, entries);
+}
+
+void History::trim()
+{
+    while (m_entries.size() > static_cast<size_t>(m_capacity))
+        m_entries.pop_front();
+
+    if (m_loaded && !m_entries.empty())
+        m_index.drop_below(m_entries.front().id);
+}
+
+void History::save_index() const
+{
+    auto data{m_index.serialize()};
+
+#if defined(USE_ENCRYPTION)
+    if (m_security)
+    {
+        bool success{false};
+        data = m_security->encrypt(data, success);
+        if (!success)
+            return;
+        data.prepend(static_cast<char>(m_security->cipher()));
+    }
+#endif
+
+    QSaveFile file(m_index_file_name);
+    if (file.open(QIODevice::WriteOnly) && file.write(data) == data.size())
+        file.commit();
+}
+
+void History::maybe_compact()
+{
+    if (!m_loaded || !m_data || m_entries.empty() || m_compact_watcher.isRunning())
+        return;
+
+    auto used{reinterpret_cast<const StoreHeader*>(m_data)->used};
+    auto first{m_entries.front().offset};
+
+    auto dead{first - sizeof(StoreHeader)};
+    auto live{used - first};
+    if (dead < compact_threshold || dead < live)
+        return;
+
+    m_compact_from = first;
+    m_compact_to = used;
+    m_compact_watcher.setFuture(QtConcurrent::run(&History::compact, m_file_name, m_compact_from, m_compact_to));
+}
+
+History::Encoded History::encode(secure_ptr_t security, int peer, QString host, QString copied_text, QString html)
+{
+    Encoded encoded;
+
+    // a peer's copy may have arrived as HTML alone; the history still
+    // needs its text for previews and search
+    encoded.text = copied_text.isEmpty() ? Representation::html_to_text(html) : copied_text;
+    if (encoded.text.isEmpty())
+        return encoded;
+
+    encoded.peer = peer;
+    encoded.host = host;
+    encoded.preview = make_preview(encoded.text);
+    encoded.qhash = content_hash(encoded.text, html);
+
+    QByteArray buffer;
+    {
+        QDataStream out(&buffer, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_5_12);
+        out << host << encoded.text << html;
+    }
+
+    buffer = qCompress(buffer);
+    if (!seal(security, buffer, encoded.cipher))
+        return encoded;
+
+    encoded.data = buffer;
+    return encoded;
+}
+
+History::Encoded History::encode_blocks(secure_ptr_t security, int peer, QString host, QString excerpt, QByteArray text_block, QByteArray html_block)
+{
+    Encoded encoded;
+
+    if (excerpt.isEmpty())
+    {
+        // the sender did not provide one, so this copy is inflated after all
+        auto text{ClipMimeData::inflate(text_block)};
+        if (text.isEmpty())
+            text = Representation::html_to_text(ClipMimeData::inflate(html_block));
+        excerpt = text.left(HistoryIndex::indexed_length);
+    }
+    if (excerpt.isEmpty())
+        return encoded;
+
+    encoded.format = blocks_format;
+    encoded.peer = peer;
+    encoded.host = host;
+    encoded.text = excerpt;
+    encoded.preview = make_preview(excerpt);
+    encoded.qhash = qHash(html_block, qHash(text_block));
+
+    // the blocks are compressed already
+    QByteArray buffer;
+    {
+        QDataStream out(&buffer, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_5_12);
+        out << host << excerpt << text_block << html_block;
+    }
+
+    if (!seal(security, buffer, encoded.cipher))
+        return encoded;
+
+    encoded.data = buffer;
+    return encoded;
+}
+
+bool History::decode(const secure_ptr_t& security, uint32_t format, uint8_t cipher, const char* data, uint32_t size, Content& content)
+{
+    QByteArray buffer(data, static_cast<int>(size));
+    if (!unseal(security, cipher, buffer))
+        return false;
+
+    if (format == blocks_format)
+    {
+        QString excerpt;
+        QByteArray text_block;
+        QByteArray html_block;
+
+        QDataStream in(buffer);
+        in.setVersion(QDataStream::Qt_5_12);
+        in >> content.host >> excerpt >> text_block >> html_block;
+        if (in.status() != QDataStream::Ok)
+            return false;
+
+        content.html = ClipMimeData::inflate(html_block);
+        content.text = text_block.isEmpty() ? Representation::html_to_text(content.html) : ClipMimeData::inflate(text_block);
+        return true;
+    }
+
+    if (format != plain_format)
+        return false;
+
+    buffer = qUncompress(buffer);
+    if (buffer.isEmpty())
+        return false;
+
+    QDataStream in(buffer);
+    in.setVersion(QDataStream::Qt_5_12);
+    in >> content.host >> content.text >> content.html;
+
+    return in.status() == QDataStream::Ok;
+}
+
+bool History::summarize(const secure_ptr_t& security, uint32_t format, uint8_t cipher, const char* data, uint32_t size, Summary& summary)
+{
+    if (format != blocks_format)
+    {
+        Content content;
+        if (!decode(security, format, cipher, data, size, content))
+            return false;
+
+        summary.host = content.host;
+        summary.text = content.text;
+        summary.qhash = content_hash(content.text, content.html);
+        return true;
+    }
+
+    // an excerpt stands in for the text, so nothing is inflated
+    QByteArray buffer(data, static_cast<int>(size));
+    if (!unseal(security, cipher, buffer))
+        return false;
+
+    QByteArray text_block;
+    QByteArray html_block;
+
+    QDataStream in(buffer);
+    in.setVersion(QDataStream::Qt_5_12);
+    in >> summary.host >> summary.text >> text_block >> html_block;
+
+    summary.qhash = qHash(html_block, qHash(text_block));
+    return in.status() == QDataStream::Ok;
+}
+
+History::LoadResult History::load(QString file_name, QString index_file_name, uint64_t used, int capacity, QString key)
+{
+    LoadResult result;
+    result.index = std::make_shared<HistoryIndex>();
+
+    QFile file(file_name);
+    if (!file.open(QIODevice::ReadOnly))
+        return result;
+
+    // keyed like the store's own, from the same key
+    secure_ptr_t security;
+#if defined(USE_ENCRYPTION)
+    security = Secure::create(key, crypto::name(crypto::stored()));
+#else
+    Q_UNUSED(key)
+#endif
+
+    // walk the record headers first; only the newest 'capacity' records
+    // are still part of the history, so only they need decoding
+    std::vector<std::pair<uint64_t, RecordHeader>> records;
+
+    auto offset{static_cast<uint64_t>(sizeof(StoreHeader))};
+    while (offset + sizeof(RecordHeader) <= used)
+    {
+        RecordHeader record;
+        if (!file.seek(static_cast<qint64>(offset)) || file.read(reinterpret_cast<char*>(&record), sizeof(record)) != sizeof(record))
+            break;
+
+        auto record_size{aligned(sizeof(RecordHeader) + record.size)};
+        if (!record.size || offset + record_size > used)
+            break;
+
+        records.emplace_back(offset, record);
+        offset += record_size;
+    }
+
+    // the saved index is only good if it describes this store
+    QFile index_file(index_file_name);
+    if (index_file.open(QIODevice::ReadOnly))
+    {
+        auto data{index_file.readAll()};
+#if defined(USE_ENCRYPTION)
+        if (security)
+        {
+            auto cipher{data.isEmpty() ? 0u : static_cast<uint8_t>(data.at(0))};
+            bool success{cipher != 0 && cipher <= crypto::max_cipher && security->supports(static_cast<crypto::Cipher>(cipher))};
+            if (success)
+                data = security->decrypt(data.mid(1), static_cast<crypto::Cipher>(cipher), success);
+            if (!success)
+                data.clear();
+        }
+#endif
+        if (!result.index->deserialize(data) || records.empty() || result.index->last_id() > records.back().second.id)
+            result.index->clear();
+    }
+
+    auto first{records.size() > static_cast<size_t>(capacity) ? records.size() - static_cast<size_t>(capacity) : 0};
+    for (auto i = first; i < records.size(); ++i)
+    {
+        const auto& record{records[i].second};
+
+        file.seek(static_cast<qint64>(records[i].first + sizeof(RecordHeader)));
+        auto encoded{file.read(record.size)};
+
+        Summary summary;
+        if (encoded.size() != static_cast<int>(record.size) || !summarize(security, record.format, record.cipher, encoded.constData(), record.size, summary))
+            continue;
+
+        Entry entry;
+        entry.id = record.id;
+        entry.timestamp = record.timestamp;
+        entry.peer = record.peer;
+        entry.host = summary.host;
+        entry.preview = make_preview(summary.text);
+        entry.qhash = summary.qhash;
+        entry.offset = records[i].first;
+
+        result.entries.push_back(entry);
+
+        if (entry.id > result.index->last_id())
+        {
+            result.index->add(entry.id, summary.text);
+            ++result.indexed;
+        }
+    }
+
+    if (!result.entries.empty())
+        result.index->drop_below(result.entries.front().id);
+
+    return result;
+}
+
+void History::slot_load_finished()
+{
+    auto result{m_load_watcher.result()};
+    if (!m_data)
+        return;
+
+    // anything appended while loading is newer than everything loaded
+    result.entries.insert(result.entries.end(), m_entries.begin(), m_entries.end());
+    m_entries.swap(result.entries);
+
+    m_index = std::move(*result.index);
+    for (const auto& unindexed : m_unindexed)
+        m_index.add(unindexed.first, unindexed.second);
+    m_unindexed.clear();
+
+    m_loaded = true;
+
+    trim();
+
+    // spare the next startup the work of indexing these again
+    if (result.indexed)
+        save_index();
+
+    emit signal_loaded();
+
+    maybe_compact();
+}
+
+QString History::compact(QString file_name, uint64_t from, uint64_t to)
+{
+    QFile source(file_name);
+    if (!source.open(QIODevice::ReadOnly) || !source.seek(static_cast<qint64>(from)))
+        return QString();
+
+    auto temp_name{file_name + ".compact"};
+    QFile target(temp_name);
+    if (!target.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return QString();
+
+    // the header is filled in once the tail has been appended
+    QByteArray header(sizeof(StoreHeader), 0);
+    bool success{target.write(header) == header.size()};
+
+    auto remaining{to - from};
+    while (success && remaining)
+    {
+        auto chunk{source.read(static_cast<qint64>(qMin<uint64_t>(remaining, 1024 * 1024)))};
+        success = !chunk.isEmpty() && target.write(chunk) == chunk.size();
+        remaining -= static_cast<uint64_t>(chunk.size());
+    }
+
+    target.close();
+
+    if (!success)
+    {
+        QFile::remove(temp_name);
+        return QString();
+    }
+
+    return temp_name;
+}
+
+void History::slot_compact_finished()
+{
+    auto temp_name{m_compact_watcher.result()};
+    if (temp_name.isEmpty())
+        return;
+
+    // a search reads the store through a handle of its own, which must be
+    // closed before the store is replaced
+    m_search_watcher.waitForFinished();
+
+    QFile temp(temp_name);
+    if (!m_data || !temp.open(QIODevice::ReadWrite))
+    {
+        QFile::remove(temp_name);
+        return;
+    }
+
+    auto header{*reinterpret_cast<const StoreHeader*>(m_data)};
+    auto shift{m_compact_from - sizeof(StoreHeader)};
+
+    // records appended while the compaction was running
+    auto tail{static_cast<qint64>(header.used - m_compact_to)};
+    bool success{temp.seek(static_cast<qint64>(sizeof(StoreHeader) + (m_compact_to - m_compact_from)))};
+    if (success && tail)
+        success = temp.write(reinterpret_cast<const char*>(m_data + m_compact_to), tail) == tail;
+
+    header.used -= shift;
+    if (success)
+        success = temp.seek(0) && temp.write(reinterpret_cast<const char*>(&header), sizeof(header)) == sizeof(header);
+
+    temp.close();
+
+    if (!success)
+    {
+        QFile::remove(temp_name);
+        return;
+    }
+
+    m_file.unmap(m_data);
+    m_data = nullptr;
+    m_mapped_size = 0;
+    m_file.close();
+
+    // replace the store in one step where the platform allows it
+    if (std::rename(QFile::encodeName(temp_name).constData(), QFile::encodeName(m_file_name).constData()) != 0)
+    {
+        QFile::remove(m_file_name);
+        QFile::rename(temp_name, m_file_name);
+    }
+
+    if (!reopen())
+    {
+        m_entries.clear();
+        return;
+    }
+
+    for (auto& entry : m_entries)
+        entry.offset -= shift;
+}
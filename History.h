@@ -0,0 +1,240 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include <QFile>
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QFutureWatcher>
+
+#include "Secure.h"
+#include "HistoryIndex.h"
+
+// A bounded history of recent clipboard entries, both our own copies and
+// those received from peers.
+//
+// Entries are appended to a memory-mapped file and never rewritten in
+// place; the entries that have fallen out of the history are dropped by
+// compacting the file in the background once they outweigh the live ones.
+// Entry contents are compressed and, in builds with encryption, encrypted
+// with a key that is private to this installation; both are done on a
+// worker thread, and entries are stored in the order they were appended.
+// A peer's copy that arrived compressed is stored as it arrived, with an
+// excerpt of its text for previews and search, and is only inflated when
+// it is recalled.
+//
+// Only a small summary of each entry (id, time, peer and a one-line
+// preview) is kept in memory.  The full content is decoded from the mapping
+// when an entry is recalled.  At startup the summaries are rebuilt on a
+// worker thread, so opening a large history does not delay launch;
+// signal_loaded() is emitted once they are available.
+//
+// A HistoryIndex over the entries' text supports substring search.  It is
+// kept up to date as entries are appended and saved, encrypted like the
+// store, in a ".idx" file next to it, so it only has to be rebuilt for
+// entries it has not yet seen.  The index only covers the leading
+// HistoryIndex::indexed_length characters of each entry, so a search does
+// not find text beyond them.  The candidates it yields are confirmed
+// against the entries' content on a worker thread.
+
+class History : public QObject
+{
+    Q_OBJECT
+
+public: // aliases and enums
+    struct Entry
+    {
+        uint64_t id{0};         // increases monotonically; never reused
+        qint64 timestamp{0};    // milliseconds since the epoch
+        int peer{0};            // sender id of the copy (ours for local copies)
+        QString host;
+        QString preview;        // first line of the text, truncated for menus
+        uint qhash{0};          // detects an immediate repeat of the newest entry
+        uint64_t offset{0};     // of the record in the store
+    };
+
+    struct Content
+    {
+        QString host;
+        QString text;
+        QString html;
+    };
+
+    using entries_t = std::deque<Entry>;
+
+public:
+    explicit History(QObject* parent = nullptr);
+    ~History();
+
+    /*!
+    Map (creating it if needed) the history store and start loading the
+    existing entries in the background.
+
+    \param file_name The path of the history store.
+    \param capacity The maximum number of entries retained.
+    \param key The private key protecting the store's contents.
+    \returns A Boolean true if the store could be mapped.
+    */
+    bool open(const QString& file_name, int capacity, const QString& key);
+    void close();
+
+    bool is_open() const { return m_data != nullptr; }
+    bool is_loaded() const { return m_loaded; }
+
+    int capacity() const { return m_capacity; }
+
+    /*!
+    Add a clipboard entry as the newest in the history, once it has been
+    encoded in the background.  An entry identical to the current newest
+    entry is not added again.
+
+    \param peer The sender id of the copy.
+    \param host The host name of the machine the copy was made on.
+    \param copied_text The plain text of the copy; if empty, it is derived from the HTML.
+    \param html The HTML of the copy, if any.
+    */
+    void append(int peer, const QString& host, const QString& copied_text, const QString& html);
+
+    /*!
+    Add a copy whose representations arrived compressed (see
+    ClipMimeData::compress()), as append() does.  The blocks are stored as
+    they are, so nothing is inflated until the entry is recalled; previews
+    and search use the excerpt.
+
+    \param peer The sender id of the copy.
+    \param host The host name of the machine the copy was made on.
+    \param excerpt At least the leading HistoryIndex::indexed_length characters of the text; if empty, the blocks are inflated for it.
+    \param text_block The compressed plain text; if empty, it is derived from the HTML.
+    \param html_block The compressed HTML, if any.
+    */
+    void append_blocks(int peer, const QString& host, const QString& excerpt, const QByteArray& text_block, const QByteArray& html_block);
+
+    /*!
+    Decode the full content of a retained entry.
+
+    \param id The id of the entry.
+    \param content Receives the content of the entry.
+    \returns A Boolean true if the entry was found and decoded.
+    */
+    bool content(uint64_t id, Content& content) const;
+
+    /*!
+    Find the newest entries whose text contains a string, and deliver them
+    with signal_searched().  A search started while another is running
+    waits for it, replacing any search already waiting.
+
+    \param query The string to find; case is ignored.
+    \param limit The maximum number of entries to find.
+    */
+    void search(const QString& query, int limit);
+
+    // oldest first
+    const entries_t& entries() const { return m_entries; }
+
+    static QString default_file_name();
+    static QString make_preview(const QString& text);
+
+signals:
+    void signal_loaded();
+
+    // the matching entries, newest first
+    void signal_searched(const QString& query, const std::vector<History::Entry>& results);
+
+private slots:
+    void slot_append_finished();
+    void slot_load_finished();
+    void slot_search_finished();
+    void slot_compact_finished();
+
+private: // aliases and enums
+    struct LoadResult
+    {
+        entries_t entries;
+        std::shared_ptr<HistoryIndex> index;
+        int indexed{0};     // entries the saved index did not already cover
+    };
+
+    // an appended entry, ready to be stored
+    struct Encoded
+    {
+        uint32_t format{0};
+        uint8_t cipher{0};  // the crypto::Cipher the data is sealed with
+        int peer{0};
+        QString host;
+        QString text;
+        QString preview;
+        uint qhash{0};
+        QByteArray data;    // empty if there is nothing to store
+    };
+
+    using append_watcher_t = QFutureWatcher<Encoded>;
+
+    // what previews, duplicate checks and search need of an entry
+    struct Summary
+    {
+        QString host;
+        QString text;       // for a copy stored compressed, only an excerpt
+        uint qhash{0};
+    };
+
+    struct SearchResult
+    {
+        QString query;
+        std::vector<Entry> entries;
+    };
+
+private: // methods
+    bool map(qint64 size);
+    bool reserve(uint64_t size);
+    bool reopen();
+    void trim();
+    const Entry* find(uint64_t id) const;
+    void save_index() const;
+    void maybe_compact();
+    void store(const Encoded& encoded);
+
+    static Encoded encode(secure_ptr_t security, int peer, QString host, QString copied_text, QString html);
+    static Encoded encode_blocks(secure_ptr_t security, int peer, QString host, QString excerpt, QByteArray text_block, QByteArray html_block);
+    static bool decode(const secure_ptr_t& security, uint32_t format, uint8_t cipher, const char* data, uint32_t size, Content& content);
+    static bool summarize(const secure_ptr_t& security, uint32_t format, uint8_t cipher, const char* data, uint32_t size, Summary& summary);
+
+    static LoadResult load(QString file_name, QString index_file_name, uint64_t used, int capacity, QString key);
+    static QString compact(QString file_name, uint64_t from, uint64_t to);
+    static SearchResult confirm(QString file_name, secure_ptr_t security, QString query, std::vector<Entry> candidates, int limit);
+
+private: // data members
+    QString m_file_name;
+    QString m_index_file_name;
+    QString m_key;
+    QFile m_file;
+    uchar* m_data{nullptr};
+    qint64 m_mapped_size{0};
+
+    int m_capacity{1000};
+
+    secure_ptr_t m_security;
+
+    entries_t m_entries;
+    bool m_loaded{false};
+
+    HistoryIndex m_index;
+
+    // entries appended while loading, indexed once the saved index is in
+    std::vector<std::pair<uint64_t, QString>> m_unindexed;
+
+    // entries being encoded, oldest first
+    std::deque<append_watcher_t*> m_appending;
+
+    QFutureWatcher<LoadResult> m_load_watcher;
+    QFutureWatcher<QString> m_compact_watcher;
+    QFutureWatcher<SearchResult> m_search_watcher;
+    bool m_search_waiting{false};   // for the running search to finish
+    QString m_next_query;
+    int m_next_limit{0};
+    uint64_t m_compact_from{0};
+    uint64_t m_compact_to{0};
+};
@@ -0,0 +1,233 @@
+#include <algorithm>
+
+#include <QDataStream>
+
+#include "HistoryIndex.h"
+
+namespace
+{
+    constexpr quint32 index_magic{0x49484e43}; // "CNHI"
+    constexpr quint32 index_version{1};
+
+    // dropped postings are swept out once they are this large a share of the live ones
+    constexpr size_t purge_divisor{2};
+
+    std::vector<uint64_t> trigrams(const QString& folded)
+    {
+        std::vector<uint64_t> keys;
+        if (folded.length() < 3)
+            return keys;
+
+        auto data{folded.utf16()};
+        keys.reserve(static_cast<size_t>(folded.length() - 2));
+        for (int i = 0; i + 2 < folded.length(); ++i)
+            keys.push_back((uint64_t(data[i]) << 32) | (uint64_t(data[i + 1]) << 16) | uint64_t(data[i + 2]));
+
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        return keys;
+    }
+} // namespace
+
+//------------------------------------------------
+// Factory methods
+
+QString HistoryIndex::fold(const QString& text)
+{
+    return text.toCaseFolded();
+}
+
+//------------------------------------------------
+// Instance methods
+
+void HistoryIndex::add(uint64_t id, const QString& text)
+{
+    if (id <= last_id())
+        return;
+
+    auto keys{trigrams(fold(text.left(indexed_length)))};
+    for (auto key : keys)
+        m_lists[key].push_back(static_cast<uint32_t>(id));
+
+    m_documents.push_back(Document{id, static_cast<uint32_t>(keys.size())});
+    m_postings += keys.size();
+
+    // keep the index within its budget by giving up on the oldest entries
+    while (m_postings > max_postings && m_documents.size() > 1)
+    {
+        m_postings -= m_documents.front().postings;
+        m_dead_postings += m_documents.front().postings;
+        m_documents.pop_front();
+    }
+
+    if (m_dead_postings > m_postings / purge_divisor)
+        purge();
+}
+
+void HistoryIndex::drop_below(uint64_t id)
+{
+    while (!m_documents.empty() && m_documents.front().id < id)
+    {
+        m_postings -= m_documents.front().postings;
+        m_dead_postings += m_documents.front().postings;
+        m_documents.pop_front();
+    }
+
+    if (m_dead_postings > m_postings / purge_divisor)
+        purge();
+}
+
+void HistoryIndex::purge()
+{
+    if (m_documents.empty())
+    {
+        clear();
+        return;
+    }
+
+    auto first{static_cast<uint32_t>(first_id())};
+    for (auto iter = m_lists.begin(); iter != m_lists.end();)
+    {
+        auto& ids{iter->second};
+        ids.erase(ids.begin(), std::lower_bound(ids.begin(), ids.end(), first));
+
+        if (ids.empty())
+            iter = m_lists.erase(iter);
+        else
+        {
+            ids.shrink_to_fit();
+            ++iter;
+        }
+    }
+
+    m_dead_postings = 0;
+}
+
+void HistoryIndex::clear()
+{
+    m_lists.clear();
+    m_documents.clear();
+    m_postings = 0;
+    m_dead_postings = 0;
+}
+
+HistoryIndex::ids_t HistoryIndex::candidates(const QString& query) const
+{
+    ids_t result;
+
+    auto keys{trigrams(fold(query.left(indexed_length)))};
+    if (keys.empty() || m_documents.empty())
+        return result;
+
+    std::vector<const std::vector<uint32_t>*> lists;
+    lists.reserve(keys.size());
+    for (auto key : keys)
+    {
+        auto iter{m_lists.find(key)};
+        if (iter == m_lists.end())
+            return result;
+        lists.push_back(&iter->second);
+    }
+
+    // walk the shortest list and probe the others
+    std::sort(lists.begin(), lists.end(), [](const std::vector<uint32_t>* a, const std::vector<uint32_t>* b) { return a->size() < b->size(); });
+
+    auto first{static_cast<uint32_t>(first_id())};
+    const auto& shortest{*lists.front()};
+    for (auto iter = shortest.rbegin(); iter != shortest.rend() && *iter >= first; ++iter)
+    {
+        auto id{*iter};
+        bool found{true};
+        for (size_t i = 1; found && i < lists.size(); ++i)
+            found = std::binary_search(lists[i]->begin(), lists[i]->end(), id);
+
+        if (found)
+            result.push_back(id);
+    }
+
+    return result;
+}
+
+QByteArray HistoryIndex::serialize() const
+{
+    QByteArray data;
+    auto first{static_cast<uint32_t>(first_id())};
+
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_12);
+    out << index_magic << index_version;
+
+    out << static_cast<quint64>(m_documents.size());
+    for (const auto& document : m_documents)
+        out << static_cast<quint64>(document.id) << static_cast<quint32>(document.postings);
+
+    out << static_cast<quint64>(m_lists.size());
+    for (const auto& list : m_lists)
+    {
+        // postings of dropped entries are not worth keeping
+        auto begin{std::lower_bound(list.second.begin(), list.second.end(), first)};
+        auto count{static_cast<quint32>(list.second.end() - begin)};
+
+        out << static_cast<quint64>(list.first) << count;
+        if (count)
+            out.writeRawData(reinterpret_cast<const char*>(&*begin), static_cast<int>(count * sizeof(uint32_t)));
+    }
+
+    return out.status() == QDataStream::Ok ? data : QByteArray();
+}
+
+bool HistoryIndex::deserialize(const QByteArray& data)
+{
+    clear();
+
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_5_12);
+
+    quint32 magic{0}, version{0};
+    in >> magic >> version;
+    if (magic != index_magic || version != index_version)
+        return false;
+
+    quint64 document_count{0};
+    in >> document_count;
+    if (document_count > max_postings)
+        return false;
+
+    for (quint64 i = 0; i < document_count && in.status() == QDataStream::Ok; ++i)
+    {
+        quint64 id{0};
+        quint32 postings{0};
+        in >> id >> postings;
+
+        m_documents.push_back(Document{id, postings});
+        m_postings += postings;
+    }
+
+    quint64 list_count{0};
+    in >> list_count;
+
+    size_t total{0};
+    for (quint64 i = 0; i < list_count && in.status() == QDataStream::Ok; ++i)
+    {
+        quint64 key{0};
+        quint32 count{0};
+        in >> key >> count;
+
+        total += count;
+        if (total > max_postings * 2)
+            break;
+
+        auto& ids{m_lists[key]};
+        ids.resize(count);
+        if (count && in.readRawData(reinterpret_cast<char*>(ids.data()), static_cast<int>(count * sizeof(uint32_t))) != static_cast<int>(count * sizeof(uint32_t)))
+            in.setStatus(QDataStream::ReadPastEnd);
+    }
+
+    if (in.status() != QDataStream::Ok || total > max_postings * 2 || total != m_postings)
+    {
+        clear();
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+#include <QString>
+#include <QByteArray>
+
+// A trigram index over the text of History entries, for substring search.
+//
+// Every distinct run of three (case-folded) characters in the leading
+// indexed_length characters of an entry maps to the ids of the entries that
+// contain it.  Ids only ever increase, so each posting list is kept sorted
+// by appending, and a query is answered by intersecting the lists of its
+// trigrams, newest first.  The result is a candidate set: an entry whose
+// leading indexed_length characters contain the query always appears in
+// it, but the caller confirms each candidate against the entry's text.
+// Text beyond those characters is not found; the History page says so.
+//
+// Memory is bounded: entries that have left the history are dropped from
+// the lists in batches, and if the postings still exceed max_postings the
+// oldest entries are dropped from the index (they remain in the history,
+// but are no longer found by search).
+
+class HistoryIndex
+{
+public: // aliases and enums
+    // characters of each entry that are indexed
+    static constexpr int indexed_length{1024};
+
+    // roughly 4 bytes each, plus the per-trigram overhead
+    static constexpr size_t max_postings{4 * 1024 * 1024};
+
+    using ids_t = std::vector<uint64_t>;
+
+public:
+    /*!
+    Index an entry.  Entries must be added in increasing id order.
+
+    \param id The History id of the entry.
+    \param text The entry's plain text.
+    */
+    void add(uint64_t id, const QString& text);
+
+    /*!
+    Forget every entry with an id below the given one.
+
+    \param id The oldest id still of interest.
+    */
+    void drop_below(uint64_t id);
+
+    /*!
+    Find the entries that may contain a string.
+
+    \param query The string to find; case is ignored.  It must be at
+                 least three characters long to use the index.
+    \returns The ids of the candidate entries, newest first.
+    */
+    ids_t candidates(const QString& query) const;
+
+    void clear();
+
+    // the newest id indexed, or zero
+    uint64_t last_id() const { return m_documents.empty() ? 0 : m_documents.back().id; }
+
+    // the oldest id the index can still find
+    uint64_t first_id() const { return m_documents.empty() ? 0 : m_documents.front().id; }
+
+    size_t postings() const { return m_postings + m_dead_postings; }
+
+    /*!
+    Flatten the index, without the postings of dropped entries, for storage.
+
+    \returns The serialized index.
+    */
+    QByteArray serialize() const;
+
+    /*!
+    Replace the index with one produced by serialize().
+
+    \param data The serialized index.
+    \returns A Boolean true if the data held a valid index; otherwise the index is left empty.
+    */
+    bool deserialize(const QByteArray& data);
+
+    static QString fold(const QString& text);
+
+private: // aliases and enums
+    struct Document
+    {
+        uint64_t id{0};
+        uint32_t postings{0};
+    };
+
+private: // methods
+    void purge();
+
+private: // data members
+    // keys pack three UTF-16 code units; values are ids (History ids fit
+    // comfortably in 32 bits), oldest first
+    std::unordered_map<uint64_t, std::vector<uint32_t>> m_lists;
+
+    // the indexed entries, oldest first
+    std::deque<Document> m_documents;
+
+    size_t m_postings{0};       // belonging to m_documents
+    size_t m_dead_postings{0};  // of dropped entries, still in m_lists
+};
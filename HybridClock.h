@@ -0,0 +1,88 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+
+// A hybrid logical clock (Kulkarni et al.): wall-clock milliseconds, plus a
+// counter that orders events the wall clock cannot tell apart.  Timestamps
+// it hands out never go backwards and are always later than any timestamp
+// it has been shown, so the order they define respects causality even when
+// the members' clocks disagree a little.
+//
+// Every clipboard message carries one.  A copy is applied only if it is
+// later than the copy already on the clipboard, with the sender id as the
+// final tie-break; every member evaluates this the same way, so concurrent
+// copies converge on a single value.
+
+namespace hlc
+{
+    struct Timestamp
+    {
+        int64_t wall{0};    // milliseconds since the epoch
+        uint32_t count{0};
+        int node{0};        // sender id; breaks ties between members
+
+        bool is_set() const { return wall != 0; }
+    };
+
+    inline bool operator<(const Timestamp& a, const Timestamp& b)
+    {
+        if (a.wall != b.wall)
+            return a.wall < b.wall;
+        if (a.count != b.count)
+            return a.count < b.count;
+        return a.node < b.node;
+    }
+
+    class Clock
+    {
+    public:
+        explicit Clock(int node = 0) : m_node(node) {}
+
+        void set_node(int node) { m_node = node; }
+
+        // a timestamp for a local event
+        Timestamp now()
+        {
+            auto wall{physical()};
+            if (wall > m_last.wall)
+            {
+                m_last.wall = wall;
+                m_last.count = 0;
+            }
+            else
+                ++m_last.count;
+
+            m_last.node = m_node;
+            return m_last;
+        }
+
+        // account for a timestamp received from another member
+        void update(const Timestamp& remote)
+        {
+            auto wall{std::max({m_last.wall, remote.wall, physical()})};
+            if (wall == m_last.wall && wall == remote.wall)
+                m_last.count = std::max(m_last.count, remote.count) + 1;
+            else if (wall == m_last.wall)
+                ++m_last.count;
+            else if (wall == remote.wall)
+                m_last.count = remote.count + 1;
+            else
+                m_last.count = 0;
+
+            m_last.wall = wall;
+        }
+
+    private:
+        static int64_t physical()
+        {
+            using namespace std::chrono;
+            return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+        }
+
+    private:
+        Timestamp m_last;
+        int m_node{0};
+    };
+} // namespace hlc
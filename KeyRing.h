@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Secure.h"
+
+// The keys a group member holds, so the group can move to a new
+// passphrase without anyone leaving.
+//
+// A packet's group tag is derived from the key that produced it, so it
+// names the packet's key epoch, and every member arrives at the same tag
+// for the same passphrase without coordinating.  A new passphrase is
+// staged as the next key (its schedule expanded there and then) while the
+// current one is still used for sending; packets under either are
+// accepted, so whichever members switch first are understood by those
+// that have only staged it.  Once promoted, the old key is kept as the
+// previous one until the copies in flight under it have arrived.
+//
+// Secure instances never change once created, so the workers holding one
+// are unaffected by a promotion.
+
+class KeyRing
+{
+public:
+    void reset(const secure_ptr_t& current = secure_ptr_t())
+    {
+        m_previous.clear();
+        m_current = current;
+        m_next.clear();
+    }
+
+    const secure_ptr_t& current() const { return m_current; }
+    const secure_ptr_t& next() const { return m_next; }
+
+    /*!
+    Stage the key for a new passphrase.
+
+    \param next The key to switch to.
+    \returns A Boolean true if a key other than the current one is now staged.
+    */
+    bool stage(const secure_ptr_t& next)
+    {
+        m_next.clear();
+        if (!next || !m_current || next->group_tag() == m_current->group_tag())
+            return false;
+
+        m_next = next;
+        return true;
+    }
+
+    // make the staged key current
+    void promote()
+    {
+        if (!m_next)
+            return;
+
+        m_previous = m_current;
+        m_current = m_next;
+        m_next.clear();
+    }
+
+    // forget the key before the current one
+    void retire() { m_previous.clear(); }
+
+    /*!
+    \param group_tag The group tag of a received packet.
+    \returns The key of that epoch, or a null pointer if we hold none.
+    */
+    secure_ptr_t find(uint32_t group_tag) const
+    {
+        for (const auto& key : {m_current, m_next, m_previous})
+        {
+            if (key && key->group_tag() == group_tag)
+                return key;
+        }
+        return secure_ptr_t();
+    }
+
+private: // data members
+    secure_ptr_t m_previous;
+    secure_ptr_t m_current;
+    secure_ptr_t m_next;
+};
@@ -0,0 +1,243 @@
+#ifdef QT_WIN
+#define WIN32_MEAN_AND_LEAN // necessary to avoid compiler errors
+#include <Windows.h>
+#include <wincred.h>
+#endif
+
+#ifdef QT_LINUX
+#include <QMap>
+#include <QList>
+#include <QVariant>
+#include <QDBusMessage>
+#include <QDBusMetaType>
+#include <QDBusArgument>
+#include <QDBusConnection>
+#include <QDBusObjectPath>
+#include <QDBusVariant>
+#endif
+
+#include "KeyStore.h"
+
+#ifdef QT_WIN
+
+namespace
+{
+    std::wstring target_name(const QString& name)
+    {
+        return QString("ClipNet/%1").arg(name).toStdWString();
+    }
+} // namespace
+
+keystore::Result keystore::read(const QString& name, QByteArray& secret)
+{
+    auto target{target_name(name)};
+
+    PCREDENTIALW credential{nullptr};
+    if (!CredReadW(target.c_str(), CRED_TYPE_GENERIC, 0, &credential))
+        return ::GetLastError() == ERROR_NOT_FOUND ? Result::missing : Result::failed;
+
+    secret = QByteArray(reinterpret_cast<const char*>(credential->CredentialBlob), static_cast<int>(credential->CredentialBlobSize));
+    CredFree(credential);
+
+    return secret.isEmpty() ? Result::missing : Result::found;
+}
+
+bool keystore::write(const QString& name, const QByteArray& secret)
+{
+    auto target{target_name(name)};
+
+    CREDENTIALW credential{};
+    credential.Type = CRED_TYPE_GENERIC;
+    credential.TargetName = const_cast<LPWSTR>(target.c_str());
+    credential.CredentialBlobSize = static_cast<DWORD>(secret.size());
+    credential.CredentialBlob = reinterpret_cast<LPBYTE>(const_cast<char*>(secret.constData()));
+    credential.Persist = CRED_PERSIST_LOCAL_MACHINE;
+
+    return CredWriteW(&credential, 0) != FALSE;
+}
+
+#elif defined(QT_LINUX)
+
+// The Secret Service API (https://specifications.freedesktop.org/secret-service/).
+// Secrets are exchanged in a "plain" session: the session bus is private
+// to the user, and the secret never leaves the machine.
+
+namespace
+{
+    const QString service_name{"org.freedesktop.secrets"};
+    const QString service_path{"/org/freedesktop/secrets"};
+    const QString default_collection{"/org/freedesktop/secrets/aliases/default"};
+
+    const QString service_interface{"org.freedesktop.Secret.Service"};
+    const QString collection_interface{"org.freedesktop.Secret.Collection"};
+    const QString item_interface{"org.freedesktop.Secret.Item"};
+    const QString session_interface{"org.freedesktop.Secret.Session"};
+
+    using attributes_t = QMap<QString, QString>;
+
+    struct Secret
+    {
+        QDBusObjectPath session;
+        QByteArray parameters;
+        QByteArray value;
+        QString content_type;
+    };
+
+    QDBusArgument& operator<<(QDBusArgument& argument, const Secret& secret)
+    {
+        argument.beginStructure();
+        argument << secret.session << secret.parameters << secret.value << secret.content_type;
+        argument.endStructure();
+        return argument;
+    }
+
+    const QDBusArgument& operator>>(const QDBusArgument& argument, Secret& secret)
+    {
+        argument.beginStructure();
+        argument >> secret.session >> secret.parameters >> secret.value >> secret.content_type;
+        argument.endStructure();
+        return argument;
+    }
+} // namespace
+
+Q_DECLARE_METATYPE(Secret)
+
+namespace
+{
+    QDBusMessage call(const QString& path, const QString& interface, const QString& method, const QList<QVariant>& arguments)
+    {
+        static bool registered{false};
+        if (!registered)
+        {
+            qDBusRegisterMetaType<Secret>();
+            qDBusRegisterMetaType<attributes_t>();
+            registered = true;
+        }
+
+        auto message{QDBusMessage::createMethodCall(service_name, path, interface, method)};
+        message.setArguments(arguments);
+        return QDBusConnection::sessionBus().call(message);
+    }
+
+    bool succeeded(const QDBusMessage& reply, int arguments)
+    {
+        return reply.type() == QDBusMessage::ReplyMessage && reply.arguments().size() >= arguments;
+    }
+
+    // secrets are exchanged within a session, which ends when we are done
+    class Session
+    {
+    public:
+        Session()
+        {
+            auto reply{call(service_path, service_interface, "OpenSession", {QString("plain"), QVariant::fromValue(QDBusVariant(QString()))})};
+            if (succeeded(reply, 2))
+                m_path = qdbus_cast<QDBusObjectPath>(reply.arguments().at(1));
+        }
+
+        ~Session()
+        {
+            if (is_open())
+                call(m_path.path(), session_interface, "Close", {});
+        }
+
+        bool is_open() const { return !m_path.path().isEmpty() && m_path.path() != "/"; }
+        const QDBusObjectPath& path() const { return m_path; }
+
+    private:
+        QDBusObjectPath m_path;
+    };
+
+    attributes_t attributes(const QString& name)
+    {
+        return attributes_t{{"application", "ClipNet"}, {"name", name}};
+    }
+} // namespace
+
+keystore::Result keystore::read(const QString& name, QByteArray& secret)
+{
+    if (!QDBusConnection::sessionBus().isConnected())
+        return Result::failed;
+
+    Session session;
+    if (!session.is_open())
+        return Result::failed;
+
+    auto found{call(service_path, service_interface, "SearchItems", {QVariant::fromValue(attributes(name))})};
+    if (!succeeded(found, 2))
+        return Result::failed;
+
+    auto items{qdbus_cast<QList<QDBusObjectPath>>(found.arguments().at(0))};
+    if (items.isEmpty())
+    {
+        // only a search that finds the item neither unlocked nor locked
+        // says it is missing
+        auto locked{qdbus_cast<QList<QDBusObjectPath>>(found.arguments().at(1))};
+        if (locked.isEmpty())
+            return Result::missing;
+
+        // a locked item can only be read once the user unlocks it; when
+        // that takes a prompt, we do without
+        auto unlocked{call(service_path, service_interface, "Unlock", {QVariant::fromValue(locked)})};
+        if (!succeeded(unlocked, 2))
+            return Result::failed;
+
+        items = qdbus_cast<QList<QDBusObjectPath>>(unlocked.arguments().at(0));
+        if (items.isEmpty())
+            return Result::failed;
+    }
+
+    auto reply{call(items.first().path(), item_interface, "GetSecret", {QVariant::fromValue(session.path())})};
+    if (!succeeded(reply, 1))
+        return Result::failed;
+
+    secret = qdbus_cast<Secret>(reply.arguments().at(0)).value;
+    return secret.isEmpty() ? Result::missing : Result::found;
+}
+
+bool keystore::write(const QString& name, const QByteArray& secret)
+{
+    if (!QDBusConnection::sessionBus().isConnected())
+        return false;
+
+    Session session;
+    if (!session.is_open())
+        return false;
+
+    QVariantMap properties;
+    properties["org.freedesktop.Secret.Item.Label"] = QString("ClipNet %1").arg(name);
+    properties["org.freedesktop.Secret.Item.Attributes"] = QVariant::fromValue(attributes(name));
+
+    Secret item_secret;
+    item_secret.session = session.path();
+    item_secret.value = secret;
+    item_secret.content_type = "application/octet-stream";
+
+    auto reply{call(default_collection, collection_interface, "CreateItem", {properties, QVariant::fromValue(item_secret), true})};
+    if (!succeeded(reply, 2))
+        return false;
+
+    // a locked collection answers with a prompt instead of the item
+    auto item{qdbus_cast<QDBusObjectPath>(reply.arguments().at(0))};
+    return !item.path().isEmpty() && item.path() != "/";
+}
+
+#else
+
+keystore::Result keystore::read(const QString& name, QByteArray& secret)
+{
+    Q_UNUSED(name)
+    Q_UNUSED(secret)
+
+    // nothing is kept, and write() says so
+    return Result::missing;
+}
+
+bool keystore::write(const QString& name, const QByteArray& secret)
+{
+    Q_UNUSED(name)
+    Q_UNUSED(secret)
+    return false;
+}
+
+#endif
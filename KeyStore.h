@@ -0,0 +1,41 @@
+#pragma once
+
+#include <QString>
+#include <QByteArray>
+
+// Secrets kept in the operating system's credential store rather than in
+// the settings file: the Credential Manager on Windows, and on Linux the
+// desktop's Secret Service (GNOME Keyring, KWallet) over D-Bus.  Where
+// there is no such store, nothing can be kept, and callers must do
+// without the secret.
+
+namespace keystore
+{
+    // a store that is locked or not answering is not the same as one that
+    // lacks the secret: only the latter may be given a new one
+    enum class Result
+    {
+        found,
+        missing,    // the store answered, and has no such secret
+        failed,     // the store could not be asked, or would not tell
+    };
+
+    /*!
+    Read a secret.  The store may take a while to answer (on Linux, a
+    D-Bus round trip per step), so this is best called off the GUI thread.
+
+    \param name The name the secret was stored under.
+    \param secret Receives the secret.
+    \returns Whether the secret was found, is missing, or could not be read.
+    */
+    Result read(const QString& name, QByteArray& secret);
+
+    /*!
+    Store a secret, replacing any already stored under the same name.
+
+    \param name The name to store the secret under.
+    \param secret The secret.
+    \returns A Boolean true if the secret was stored.
+    */
+    bool write(const QString& name, const QByteArray& secret);
+} // namespace keystore
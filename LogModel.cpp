@@ -0,0 +1,134 @@
+#include <QColor>
+#include <QDateTime>
+#include <QStringList>
+
+#include "LogModel.h"
+
+LogModel::LogModel(int capacity, QObject* parent) : QAbstractListModel(parent), m_ring(static_cast<size_t>(qMax(1, capacity)))
+{}
+
+void LogModel::append(Severity severity, const QString& text)
+{
+    auto capacity{static_cast<uint64_t>(m_ring.size())};
+    auto sequence{m_next_sequence++};
+
+    // the slot we are about to reuse may still be on display
+    if (sequence >= capacity && !m_visible.empty() && m_visible.front() == sequence - capacity)
+    {
+        if (m_live)
+            beginRemoveRows(QModelIndex(), 0, 0);
+        m_visible.pop_front();
+        if (m_live)
+            endRemoveRows();
+    }
+
+    auto& entry{m_ring[static_cast<size_t>(sequence % capacity)]};
+    entry.timestamp = QDateTime::currentMSecsSinceEpoch();
+    entry.severity = severity;
+    entry.text = text;
+
+    if (severity < m_minimum_severity)
+        return;
+
+    if (m_live)
+    {
+        auto row{static_cast<int>(m_visible.size())};
+        beginInsertRows(QModelIndex(), row, row);
+        m_visible.push_back(sequence);
+        endInsertRows();
+    }
+    else
+        m_visible.push_back(sequence);
+}
+
+void LogModel::set_minimum_severity(Severity severity)
+{
+    if (severity == m_minimum_severity)
+        return;
+
+    beginResetModel();
+    m_minimum_severity = severity;
+    rebuild_visible();
+    endResetModel();
+}
+
+void LogModel::set_live(bool live)
+{
+    if (live == m_live)
+        return;
+
+    beginResetModel();
+    m_live = live;
+    endResetModel();
+}
+
+void LogModel::rebuild_visible()
+{
+    m_visible.clear();
+
+    auto capacity{static_cast<uint64_t>(m_ring.size())};
+    auto first{m_next_sequence > capacity ? m_next_sequence - capacity : 0};
+    for (auto sequence = first; sequence < m_next_sequence; ++sequence)
+    {
+        if (m_ring[static_cast<size_t>(sequence % capacity)].severity >= m_minimum_severity)
+            m_visible.push_back(sequence);
+    }
+}
+
+int LogModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.isValid() || !m_live)
+        return 0;
+    return static_cast<int>(m_visible.size());
+}
+
+QVariant LogModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || !m_live || index.row() >= static_cast<int>(m_visible.size()))
+        return QVariant();
+
+    const auto& entry{m_ring[static_cast<size_t>(m_visible[static_cast<size_t>(index.row())] % m_ring.size())]};
+
+    switch (role)
+    {
+        case Qt::DisplayRole:
+            {
+                QStringList info;
+                info << QDateTime::fromMSecsSinceEpoch(entry.timestamp).toString() << entry.text;
+                return info.join(" :: ");
+            }
+
+        case Qt::ForegroundRole:
+            if (entry.severity == Severity::Warning)
+                return QColor(176, 112, 0);
+            if (entry.severity == Severity::Error)
+                return QColor(192, 0, 0);
+            if (entry.severity == Severity::Debug)
+                return QColor(128, 128, 128);
+            break;
+
+        case SeverityRole:
+            return static_cast<int>(entry.severity);
+
+        default:
+            break;
+    }
+
+    return QVariant();
+}
+
+QString LogModel::name(Severity severity)
+{
+    switch (severity)
+    {
+        case Severity::Debug:
+            return tr("Debug");
+        case Severity::Info:
+            return tr("Info");
+        case Severity::Warning:
+            return tr("Warning");
+        case Severity::Error:
+            return tr("Error");
+    }
+    return QString();
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <deque>
+#include <cstdint>
+#include <vector>
+
+#include <QString>
+#include <QAbstractListModel>
+
+// A fixed-capacity event log.  Entries live in a ring buffer, so memory is
+// bounded no matter how long the process runs, and appending is O(1).  The
+// model is meant to back a QListView with uniform item sizes, which only
+// ever lays out the rows that are on screen.
+//
+// While the window is hidden the model is taken "offline": it reports no
+// rows and appends emit no signals, so logging costs nothing beyond storing
+// the entry.  Going live again is a single model reset.
+
+class LogModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public: // aliases and enums
+    enum class Severity
+    {
+        Debug,
+        Info,
+        Warning,
+        Error,
+    };
+
+    enum Roles
+    {
+        SeverityRole = Qt::UserRole + 1,
+    };
+
+public:
+    explicit LogModel(int capacity = 5000, QObject* parent = nullptr);
+
+    /*!
+    Add an entry to the log, evicting the oldest entry if the log is full.
+
+    \param severity The severity of the entry.
+    \param text The text of the entry; a timestamp is added automatically.
+    */
+    void append(Severity severity, const QString& text);
+
+    /*!
+    Only entries at or above this severity are presented to views.
+
+    \param severity The minimum severity to show.
+    */
+    void set_minimum_severity(Severity severity);
+    Severity minimum_severity() const { return m_minimum_severity; }
+
+    /*!
+    Take the model online (views see every retained entry) or offline (views
+    see nothing and appends are silent).
+
+    \param live True while a view is actually on screen.
+    */
+    void set_live(bool live);
+
+    int capacity() const { return static_cast<int>(m_ring.size()); }
+
+    static QString name(Severity severity);
+
+    // QAbstractListModel
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+private: // aliases and enums
+    struct Entry
+    {
+        qint64 timestamp{0};
+        Severity severity{Severity::Info};
+        QString text;
+    };
+
+private: // methods
+    void rebuild_visible();
+
+private: // data members
+    std::vector<Entry> m_ring;
+    uint64_t m_next_sequence{0};    // total entries ever appended
+
+    // sequence numbers of the retained entries that pass the filter
+    std::deque<uint64_t> m_visible;
+
+    Severity m_minimum_severity{Severity::Info};
+    bool m_live{true};
+};
@@ -0,0 +1,199 @@
+#include <QJsonArray>
+
+#include "Metrics.h"
+
+//------------------------------------------------
+// Factory methods
+
+Metrics& Metrics::instance()
+{
+    static Metrics metrics;
+    return metrics;
+}
+
+//------------------------------------------------
+// LatencyHistogram
+
+static int bucket_of(uint64_t value)
+{
+    int bucket{0};
+    while (value && bucket < Metrics::bucket_count - 1)
+    {
+        value >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+// the upper bound of a bucket; percentiles are reported conservatively
+static uint64_t bucket_limit(int bucket)
+{
+    return bucket ? (uint64_t(1) << bucket) - 1 : 0;
+}
+
+void Metrics::LatencyHistogram::record(uint64_t value)
+{
+    m_buckets[static_cast<size_t>(bucket_of(value))].fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(value, std::memory_order_relaxed);
+
+    auto current{m_max.load(std::memory_order_relaxed)};
+    while (value > current && !m_max.compare_exchange_weak(current, value, std::memory_order_relaxed))
+        ;
+}
+
+QJsonObject Metrics::LatencyHistogram::snapshot() const
+{
+    std::array<uint64_t, bucket_count> buckets;
+    uint64_t total{0};
+    for (size_t i = 0; i < buckets.size(); ++i)
+    {
+        buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+        total += buckets[i];
+    }
+
+    auto percentile = [&buckets, total](double p) -> uint64_t {
+        if (!total)
+            return 0;
+        auto rank{static_cast<uint64_t>(p * static_cast<double>(total))};
+        uint64_t seen{0};
+        for (size_t i = 0; i < buckets.size(); ++i)
+        {
+            seen += buckets[i];
+            if (seen > rank)
+                return bucket_limit(static_cast<int>(i));
+        }
+        return bucket_limit(bucket_count - 1);
+    };
+
+    auto sum{m_sum.load(std::memory_order_relaxed)};
+
+    QJsonObject json;
+    json["count"] = static_cast<double>(total);
+    json["mean"] = total ? static_cast<double>(sum) / static_cast<double>(total) : 0.0;
+    json["p50"] = static_cast<double>(percentile(0.50));
+    json["p99"] = static_cast<double>(percentile(0.99));
+    json["max"] = static_cast<double>(m_max.load(std::memory_order_relaxed));
+    return json;
+}
+
+//------------------------------------------------
+// Instance methods
+
+void Metrics::record_peer_latency(int peer, uint64_t milliseconds)
+{
+    if (!peer)
+        return;
+
+    for (auto& slot : m_peers)
+    {
+        auto owner{slot.peer.load(std::memory_order_acquire)};
+        if (owner == 0)
+        {
+            // claim the free slot (or discover someone else claimed it)
+            if (!slot.peer.compare_exchange_strong(owner, peer, std::memory_order_acq_rel))
+            {
+                if (owner != peer)
+                    continue;
+            }
+            owner = peer;
+        }
+
+        if (owner == peer)
+        {
+            slot.latency.record(milliseconds);
+            return;
+        }
+    }
+}
+
+QJsonObject Metrics::snapshot() const
+{
+    QJsonObject counters;
+    for (int i = 0; i < static_cast<int>(Counter::Count); ++i)
+        counters[name(static_cast<Counter>(i))] = static_cast<double>(m_counters[static_cast<size_t>(i)].load(std::memory_order_relaxed));
+
+    QJsonObject histograms;
+    for (int i = 0; i < static_cast<int>(Histogram::Count); ++i)
+        histograms[name(static_cast<Histogram>(i))] = m_histograms[static_cast<size_t>(i)].snapshot();
+
+    QJsonArray peers;
+    for (const auto& slot : m_peers)
+    {
+        auto peer{slot.peer.load(std::memory_order_acquire)};
+        if (!peer)
+            break;
+
+        QJsonObject entry;
+        entry["peer"] = QString::number(peer, 16);
+        entry["latency_ms"] = slot.latency.snapshot();
+        peers.append(entry);
+    }
+
+    QJsonObject json;
+    json["counters"] = counters;
+    json["histograms"] = histograms;
+    json["peers"] = peers;
+    return json;
+}
+
+const char* Metrics::name(Counter counter)
+{
+    switch (counter)
+    {
+        case Counter::MessagesSent:
+            return "messages_sent";
+        case Counter::BytesSent:
+            return "bytes_sent";
+        case Counter::SendFailures:
+            return "send_failures";
+        case Counter::FragmentsSent:
+            return "fragments_sent";
+        case Counter::DatagramsReceived:
+            return "datagrams_received";
+        case Counter::BytesReceived:
+            return "bytes_received";
+        case Counter::FragmentsReceived:
+            return "fragments_received";
+        case Counter::MessagesApplied:
+            return "messages_applied";
+        case Counter::Malformed:
+            return "malformed";
+        case Counter::OwnPackets:
+            return "own_packets";
+        case Counter::Rejected:
+            return "rejected";
+        case Counter::CipherRejected:
+            return "cipher_rejected";
+        case Counter::DecryptFailures:
+            return "decrypt_failures";
+        case Counter::ParseFailures:
+            return "parse_failures";
+        case Counter::EchoSuppressions:
+            return "echo_suppressions";
+        case Counter::Superseded:
+            return "superseded";
+        case Counter::PolledChanges:
+            return "polled_changes";
+        default:
+            break;
+    }
+    return "unknown";
+}
+
+const char* Metrics::name(Histogram histogram)
+{
+    switch (histogram)
+    {
+        case Histogram::SerializeMicroseconds:
+            return "serialize_us";
+        case Histogram::DecodeMicroseconds:
+            return "decode_us";
+        case Histogram::ApplyMicroseconds:
+            return "apply_us";
+        case Histogram::PayloadBytes:
+            return "payload_bytes";
+        default:
+            break;
+    }
+    return "unknown";
+}
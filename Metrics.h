@@ -0,0 +1,107 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include <QJsonObject>
+
+// Process-wide counters and histograms for the sync pipeline.  Every
+// update is a single relaxed atomic operation, so instrumenting the hot
+// path costs next to nothing and is safe from any thread.
+
+class Metrics
+{
+public: // aliases and enums
+    enum class Counter
+    {
+        MessagesSent,
+        BytesSent,
+        SendFailures,
+        FragmentsSent,
+        DatagramsReceived,
+        BytesReceived,
+        FragmentsReceived,
+        MessagesApplied,
+        Malformed,          // failed the structural checks
+        OwnPackets,         // our own multicast traffic looped back to us
+        Rejected,           // failed the group tag / header MAC check
+        CipherRejected,     // encrypted with a cipher this build lacks, or below minimum_cipher
+        DecryptFailures,
+        ParseFailures,
+        EchoSuppressions,   // clipboard changes we caused ourselves
+        Superseded,         // decoded, but a newer copy was applied in its place
+        PolledChanges,      // local copies caught by polling before any notification
+
+        Count
+    };
+
+    enum class Histogram
+    {
+        SerializeMicroseconds,  // JSON + compression + encryption of an outgoing copy
+        DecodeMicroseconds,     // decryption + JSON parse of an incoming copy
+        ApplyMicroseconds,      // QClipboard::setMimeData
+        PayloadBytes,
+
+        Count
+    };
+
+    // log2 buckets: bucket 0 holds zero, bucket i holds [2^(i-1), 2^i)
+    static constexpr int bucket_count{64};
+
+    // peers beyond this are folded into the totals only
+    static constexpr int max_peers{64};
+
+    class LatencyHistogram
+    {
+    public:
+        void record(uint64_t value);
+        QJsonObject snapshot() const;
+
+    private:
+        std::array<std::atomic<uint64_t>, bucket_count> m_buckets{};
+        std::atomic<uint64_t> m_sum{0};
+        std::atomic<uint64_t> m_max{0};
+    };
+
+public:
+    static Metrics& instance();
+
+    void add(Counter counter, uint64_t amount = 1) { m_counters[static_cast<size_t>(counter)].fetch_add(amount, std::memory_order_relaxed); }
+    uint64_t value(Counter counter) const { return m_counters[static_cast<size_t>(counter)].load(std::memory_order_relaxed); }
+
+    void record(Histogram histogram, uint64_t value) { m_histograms[static_cast<size_t>(histogram)].record(value); }
+
+    /*!
+    Record the end-to-end latency of a message from a given peer, as
+    measured from the sender's timestamp to the moment it was applied.
+
+    \param peer The peer's sender id.
+    \param milliseconds The measured latency.
+    */
+    void record_peer_latency(int peer, uint64_t milliseconds);
+
+    /*!
+    Capture the current state of every counter and histogram.
+
+    \returns A JSON object suitable for display or export.
+    */
+    QJsonObject snapshot() const;
+
+    static const char* name(Counter counter);
+    static const char* name(Histogram histogram);
+
+private:
+    Metrics() = default;
+
+    struct PeerSlot
+    {
+        std::atomic<int> peer{0}; // zero means the slot is free
+        LatencyHistogram latency;
+    };
+
+private: // data members
+    std::array<std::atomic<uint64_t>, static_cast<size_t>(Counter::Count)> m_counters{};
+    std::array<LatencyHistogram, static_cast<size_t>(Histogram::Count)> m_histograms;
+    std::array<PeerSlot, max_peers> m_peers;
+};
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include <QVector>
+#include <QByteArray>
+
+#include "Secure.h"
+#include "SipHash.h"
+
+// This is the ClipNet wire format.  It is shared by MainWindow and the
+// benchmark harnesses so both speak to the group in exactly the same way.
+
+constexpr int magic_number{('N' << 24) | ('T' << 16) | ('C' << 8) | 'L'};
+constexpr int multicast_port{45454};
+
+enum class Action : uint32_t
+{
+    None,
+    ClipData,
+    CompressedClipData, // ClipData as a JSON envelope followed by separately qCompress()ed representations
+    Preview,            // announces a large copy before its body: a prefix of the text, its size and hash
+    Fragment,           // one piece of a body too large for a single datagram
+};
+
+struct Packet
+{
+    int magic{magic_number}; // uniquely identifies this data as belonging to ClipNet
+
+    int sender{0}; // value unique to a sender; used to filter/discard captured packets
+
+    int action{static_cast<uint32_t>(Action::None)};
+    int payload_size;
+
+    uint32_t message_id{0}; // sender-local sequence number; correlates a copy across peers
+    uint32_t group_tag{0}; // derived from the group key, so it names the key epoch; lets members skip foreign traffic cheaply
+    uint32_t cipher{0};    // the crypto::Cipher the payload was encrypted with; members may choose different ones
+    uint64_t mac{0};       // keyed hash of the header and a payload prefix, checked before decryption
+
+    uint8_t payload[1];
+};
+
+// bodies larger than this are sent as Fragment packets
+constexpr int max_datagram_payload{60 * 1024};
+
+// leads the payload of every Fragment packet, so the header MAC covers it
+struct Fragment
+{
+    uint32_t index{0};
+    uint32_t count{0};
+    uint32_t body_size{0};  // of the reassembled body
+    uint32_t action{0};     // the Action of the reassembled body
+
+    // followed by this fragment's bytes of the body
+};
+
+// how much of the payload the header MAC covers; enough to bind the
+// header to its payload without making the check proportional to size
+constexpr int mac_prefix_size{64};
+
+/*!
+Compute the header MAC for a packet.  The MAC covers every header field
+except the magic number and the MAC itself, plus the leading bytes of
+the payload.
+
+\param packet The packet whose header is to be authenticated.
+\param key The siphash::key_size byte key (see Secure::filter_key()).
+\returns The 64-bit MAC value.
+*/
+inline uint64_t packet_mac(const Packet* packet, const uint8_t* key)
+{
+    uint8_t buffer[6 * sizeof(int) + mac_prefix_size];
+    size_t offset{0};
+
+    auto append = [&buffer, &offset](const void* data, size_t size) {
+        ::memcpy(buffer + offset, data, size);
+        offset += size;
+    };
+
+    append(&packet->sender, sizeof(packet->sender));
+    append(&packet->action, sizeof(packet->action));
+    append(&packet->payload_size, sizeof(packet->payload_size));
+    append(&packet->message_id, sizeof(packet->message_id));
+    append(&packet->group_tag, sizeof(packet->group_tag));
+    append(&packet->cipher, sizeof(packet->cipher));
+    append(&packet->payload[0], static_cast<size_t>(qMin(packet->payload_size, mac_prefix_size)));
+
+    return siphash::hash(key, buffer, offset);
+}
+
+/*!
+Wrap a (possibly encrypted) payload in a Packet header, ready to be
+handed to Sender::send_datagram().
+
+\param sender The value that uniquely identifies this sender.
+\param message_id The sender-local id of this message.
+\param action The Action the peers should take with the payload.
+\param payload The payload bytes to be carried.
+\param security If provided, the Secure instance whose key tags and authenticates the header, and whose cipher encrypted the payload.
+\returns A buffer containing the complete datagram.
+*/
+inline QByteArray build_packet(int sender, uint32_t message_id, Action action, const QByteArray& payload, const secure_ptr_t& security = secure_ptr_t())
+{
+    auto packet_size{static_cast<int>(sizeof(Packet)) + static_cast<int>(payload.length())};
+    auto data{QByteArray(packet_size, 0)};
+    auto packet{reinterpret_cast<Packet*>(data.data())};
+
+    packet->magic = magic_number;
+    packet->sender = sender;
+    packet->message_id = message_id;
+    packet->action = static_cast<int>(action);
+    packet->payload_size = static_cast<int>(payload.length());
+    ::memcpy(&packet->payload, payload.constData(), static_cast<size_t>(packet->payload_size));
+
+    if (security)
+    {
+        packet->group_tag = security->group_tag();
+        packet->cipher = static_cast<uint32_t>(security->cipher());
+        packet->mac = packet_mac(packet, security->filter_key());
+    }
+
+    return data;
+}
+
+/*!
+Perform the structural checks every incoming datagram must pass before
+any of its fields can be trusted.
+
+\param datagram The raw datagram as received from the socket.
+\returns A pointer to the Packet header, or nullptr if the datagram is malformed.
+*/
+inline const Packet* parse_packet(const QByteArray& datagram)
+{
+    if (datagram.size() < static_cast<int>(sizeof(Packet)))
+        return nullptr;
+
+    auto packet{reinterpret_cast<const Packet*>(datagram.constData())};
+    if (packet->magic != magic_number)
+        return nullptr;
+    if (packet->payload_size < 0 || packet->payload_size > datagram.size() - static_cast<int>(sizeof(Packet)))
+        return nullptr;
+
+    return packet;
+}
+
+/*!
+Cheaply decide whether a packet was produced with our key.  This is a
+constant-time check (independent of payload size) that must pass before
+any payload is decrypted or parsed.
+
+\param packet A packet that has passed parse_packet().
+\param security The Secure instance for the group, if any.
+\returns True if the packet belongs to our group.
+*/
+inline bool verify_packet(const Packet* packet, const secure_ptr_t& security)
+{
+    if (!security)
+        return true;
+    if (packet->group_tag != security->group_tag())
+        return false;
+
+    return packet->mac == packet_mac(packet, security->filter_key());
+}
+
+/*!
+Split a body too large for one datagram into Fragment packets.  Each
+fragment is authenticated on its own, so a receiver can reject foreign
+or forged pieces before it reassembles anything.
+
+\param sender The value that uniquely identifies this sender.
+\param message_id The sender-local id of this message.
+\param action The Action the peers should take with the reassembled body.
+\param body The (possibly encrypted) body to be carried.
+\param security If provided, the Secure instance whose key tags and authenticates the headers.
+\returns The datagrams, in order.
+*/
+inline QVector<QByteArray> build_fragments(int sender, uint32_t message_id, Action action, const QByteArray& body, const secure_ptr_t& security = secure_ptr_t())
+{
+    constexpr int piece_size{max_datagram_payload - static_cast<int>(sizeof(Fragment))};
+
+    Fragment fragment;
+    fragment.count = static_cast<uint32_t>((body.size() + piece_size - 1) / piece_size);
+    fragment.body_size = static_cast<uint32_t>(body.size());
+    fragment.action = static_cast<uint32_t>(action);
+
+    QVector<QByteArray> datagrams;
+    datagrams.reserve(static_cast<int>(fragment.count));
+
+    for (; fragment.index < fragment.count; ++fragment.index)
+    {
+        auto offset{static_cast<int>(fragment.index) * piece_size};
+
+        QByteArray payload(reinterpret_cast<const char*>(&fragment), sizeof(Fragment));
+        payload.append(body.constData() + offset, qMin(piece_size, body.size() - offset));
+
+        datagrams.append(build_packet(sender, message_id, Action::Fragment, payload, security));
+    }
+
+    return datagrams;
+}
+
+/*!
+Check the Fragment header of a packet that has passed verify_packet().
+
+\param packet A packet whose action is Action::Fragment.
+\returns A pointer to the Fragment header, or nullptr if it is inconsistent.
+*/
+inline const Fragment* parse_fragment(const Packet* packet)
+{
+    if (packet->payload_size < static_cast<int>(sizeof(Fragment)))
+        return nullptr;
+
+    auto fragment{reinterpret_cast<const Fragment*>(&packet->payload[0])};
+    if (fragment->count == 0 || fragment->index >= fragment->count)
+        return nullptr;
+    if (fragment->body_size > fragment->count * static_cast<uint64_t>(max_datagram_payload))
+        return nullptr;
+
+    return fragment;
+}
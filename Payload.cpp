@@ -0,0 +1,82 @@
+#include <QDataStream>
+
+#include "Trace.h"
+#include "Payload.h"
+#include "ClipMimeData.h"
+#include "HistoryIndex.h"
+#include "Representation.h"
+
+namespace
+{
+    // characters of text a compressed copy also carries as they are, so
+    // receivers can keep it in their history without inflating it
+    constexpr int excerpt_length{HistoryIndex::indexed_length};
+} // namespace
+
+QByteArray payload::build(QJsonObject json, const QString& text, const QString& html, int sender, uint32_t message_id, Action& action)
+{
+    Representation representation;
+    {
+        TraceScope scope(Trace::Stage::Serialize, sender, message_id);
+        representation = Representation::choose(text, html);
+    }
+
+    QByteArray compressed;
+    if (representation.text.size() + representation.html.size() >= compress_threshold)
+    {
+        // each representation is compressed on its own, so receivers can
+        // hold them compressed and inflate only the ones that get pasted
+        TraceScope scope(Trace::Stage::Compress, sender, message_id);
+
+        auto envelope{json};
+        envelope["excerpt"] = (text.isEmpty() ? Representation::html_to_text(representation.html) : text).left(excerpt_length);
+
+        QDataStream out(&compressed, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_5_12);
+        out << QJsonDocument(envelope).toJson(QJsonDocument::Compact)
+            << ClipMimeData::compress(representation.text)
+            << ClipMimeData::compress(representation.html);
+    }
+
+    QByteArray payload;
+    {
+        TraceScope scope(Trace::Stage::Serialize, sender, message_id);
+
+        json["text"] = representation.text;
+        json["html"] = representation.html;
+
+        payload = QJsonDocument(json).toJson();
+    }
+
+    // content that does not compress (images already compressed and
+    // embedded in the HTML, say) is sent as it is
+    action = Action::ClipData;
+    if (!compressed.isEmpty() && compressed.size() < payload.size())
+    {
+        payload = compressed;
+        action = Action::CompressedClipData;
+    }
+
+    return payload;
+}
+
+payload::Parsed payload::parse(const QByteArray& buffer, Action action, int sender, uint32_t message_id)
+{
+    TraceScope scope(Trace::Stage::Parse, sender, message_id);
+
+    Parsed parsed;
+    if (action == Action::CompressedClipData)
+    {
+        QByteArray envelope;
+        QDataStream in(buffer);
+        in.setVersion(QDataStream::Qt_5_12);
+        in >> envelope >> parsed.text_block >> parsed.html_block;
+
+        if (in.status() == QDataStream::Ok)
+            parsed.json = QJsonDocument::fromJson(envelope);
+    }
+    else
+        parsed.json = QJsonDocument::fromJson(buffer);
+
+    return parsed;
+}
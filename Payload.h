@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+
+#include <QString>
+#include <QByteArray>
+#include <QJsonObject>
+#include <QJsonDocument>
+
+#include "Packet.h"
+
+// The payload of a copy, before encryption: the representations chosen
+// for the wire as a JSON document or, for larger copies, a JSON envelope
+// followed by each representation compressed on its own.  Like Packet.h,
+// it is shared by MainWindow and the benchmark harnesses, so both do the
+// same work for a copy.
+
+namespace payload
+{
+    // payloads smaller than this are sent as they are; compressing them
+    // saves next to nothing on the wire
+    constexpr int compress_threshold{1024};
+
+    /*!
+    Serialize a copy.  This grows with the copy, so it belongs on a worker.
+
+    \param json The fields every copy carries (host, sent, ...).
+    \param text The plain text of the copy.
+    \param html The HTML of the copy, if any.
+    \param sender The sender, for tracing.
+    \param message_id The message id, for tracing.
+    \param action Set to the Action the payload is to be sent as.
+    \returns The payload, not yet encrypted.
+    */
+    QByteArray build(QJsonObject json, const QString& text, const QString& html, int sender, uint32_t message_id, Action& action);
+
+    // a payload taken apart; a compressed copy's representations are left
+    // compressed for the clipboard data to inflate
+    struct Parsed
+    {
+        QJsonDocument json;     // null if the payload is malformed
+        QByteArray text_block;
+        QByteArray html_block;
+    };
+
+    /*!
+    \param buffer The decrypted payload.
+    \param action The Action it arrived as.
+    \param sender The sender, for tracing.
+    \param message_id The message id, for tracing.
+    \returns The parsed payload.
+    */
+    Parsed parse(const QByteArray& buffer, Action action, int sender, uint32_t message_id);
+} // namespace payload
@@ -0,0 +1,45 @@
+#pragma once
+
+// USDT (user-level statically defined tracing) probes at the boundaries of
+// the sync pipeline, for use with bpftrace, perf, SystemTap, etc. on live
+// machines.  Each probe site compiles to a single NOP until a tracer
+// attaches to it, so they stay in production builds.
+//
+// Probes (provider "clipnet"; sender is the peer id, message is the
+// sender-local message id carried in the packet header):
+//
+//   clipboard_changed   (sender, message)
+//   payload_serialized  (sender, message, payload bytes)
+//   encrypt_start       (sender, message, plain bytes)
+//   encrypt_end         (sender, message, cipher bytes)
+//   datagram_sent       (sender, message, datagram bytes, success)
+//   datagram_received   (sender, message, datagram bytes)
+//   packet_rejected     (sender, message, reason)
+//   decrypt_done        (sender, message, plain bytes, success)
+//   clipboard_applied   (sender, message, text bytes, html bytes)
+//                       compressed sizes for a copy held compressed
+//
+// List them with "bpftrace -l 'usdt:/path/to/ClipNet:clipnet:*'".
+
+#if defined(CLIPNET_USDT)
+#include <sys/sdt.h>
+
+#define CLIPNET_PROBE2(name, a1, a2) DTRACE_PROBE2(clipnet, name, a1, a2)
+#define CLIPNET_PROBE3(name, a1, a2, a3) DTRACE_PROBE3(clipnet, name, a1, a2, a3)
+#define CLIPNET_PROBE4(name, a1, a2, a3, a4) DTRACE_PROBE4(clipnet, name, a1, a2, a3, a4)
+#else
+// sizeof() keeps probe-only arguments "used" without evaluating them
+#define CLIPNET_PROBE2(name, a1, a2) do { (void)sizeof(a1); (void)sizeof(a2); } while (0)
+#define CLIPNET_PROBE3(name, a1, a2, a3) do { (void)sizeof(a1); (void)sizeof(a2); (void)sizeof(a3); } while (0)
+#define CLIPNET_PROBE4(name, a1, a2, a3, a4) do { (void)sizeof(a1); (void)sizeof(a2); (void)sizeof(a3); (void)sizeof(a4); } while (0)
+#endif
+
+// reasons passed to packet_rejected
+enum class RejectReason : int
+{
+    Malformed = 1,
+    GroupMismatch = 2,
+    DecryptFailed = 3,
+    ParseFailed = 4,
+    CipherRejected = 5,     // a cipher this build lacks, or below minimum_cipher
+};
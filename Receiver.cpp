@@ -1,8 +1,20 @@
-#include <QtWidgets>
+#include <QtCore>
 #include <QtNetwork>
 
+#include "Trace.h"
+#include "Packet.h"
 #include "Receiver.h"
 
+// tag a receive span with the message it carried, if it is one of ours
+static void trace_message(TraceScope& scope, const QByteArray& datagram)
+{
+    if (!Trace::enabled())
+        return;
+
+    if (auto packet = parse_packet(datagram))
+        scope.set_message(packet->sender, packet->message_id);
+}
+
 // https://code.qt.io/cgit/qt/qtbase.git/tree/examples/network/multicastreceiver?h=5.15
 
 Receiver::Receiver(uint16_t group_port, const QString& ipv4_group, const QString& ipv6_group, QObject* parent) :
@@ -30,8 +42,14 @@ void Receiver::slot_process_datagrams()
     while (udp_socket_ipv4.hasPendingDatagrams())
     {
         QByteArray datagram;
-        datagram.resize(static_cast<int>(udp_socket_ipv4.pendingDatagramSize()));
-        udp_socket_ipv4.readDatagram(datagram.data(), datagram.size());
+        {
+            TraceScope scope(Trace::Stage::Receive);
+
+            datagram.resize(static_cast<int>(udp_socket_ipv4.pendingDatagramSize()));
+            udp_socket_ipv4.readDatagram(datagram.data(), datagram.size());
+
+            trace_message(scope, datagram);
+        }
 
         emit signal_datagram_avaialble(datagram);
     }
@@ -39,7 +57,14 @@ void Receiver::slot_process_datagrams()
     // using QUdpSocket::receiveDatagram (API since Qt 5.8)
     while (udp_socket_ipv6.hasPendingDatagrams())
     {
-        auto dgram{udp_socket_ipv6.receiveDatagram()};
+        QNetworkDatagram dgram;
+        {
+            TraceScope scope(Trace::Stage::Receive);
+
+            dgram = udp_socket_ipv6.receiveDatagram();
+
+            trace_message(scope, dgram.data());
+        }
 
         emit signal_datagram_avaialble(dgram.data());
     }
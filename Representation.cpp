@@ -0,0 +1,328 @@
+#include "Representation.h"
+
+namespace
+{
+    bool is_html_space(QChar c)
+    {
+        // not QChar::isSpace(): a non-breaking space is content
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+    }
+
+    struct Tag
+    {
+        QString name;       // lower case; empty for comments, doctypes, ...
+        bool closing{false};
+        int end{-1};        // index just past the '>'
+    };
+
+    // parse the tag starting at html[start] == '<'; end is -1 if it is not a tag
+    Tag parse_tag(const QString& html, int start)
+    {
+        Tag tag;
+
+        auto i{start + 1};
+        if (i < html.size() && html[i] == '/')
+        {
+            tag.closing = true;
+            ++i;
+        }
+
+        if (i >= html.size() || !(html[i].isLetter() || html[i] == '!' || html[i] == '?'))
+            return tag;
+
+        auto close{html.indexOf('>', i)};
+        if (close < 0)
+            return tag;
+
+        auto name_end{i};
+        while (name_end < close && html[name_end].isLetterOrNumber())
+            ++name_end;
+
+        tag.name = html.mid(i, name_end - i).toLower();
+        tag.end = close + 1;
+        return tag;
+    }
+
+    // the index of the tag closing a raw-text element, or the end of the html
+    int find_closing(const QString& html, const QString& name, int from)
+    {
+        auto index{html.indexOf(QString("</%1").arg(name), from, Qt::CaseInsensitive)};
+        return index < 0 ? html.size() : index;
+    }
+
+    // whether a tag's inline style keeps the whitespace of its contents,
+    // as IDEs and view-source style the code they put on the clipboard
+    bool preserves_whitespace(const QStringRef& tag)
+    {
+        if (!tag.contains(QLatin1String("white-space"), Qt::CaseInsensitive))
+            return false;
+
+        QString style;
+        for (auto c : tag)
+        {
+            if (!is_html_space(c))
+                style += c.toLower();
+        }
+        return style.contains(QLatin1String("white-space:pre")) || style.contains(QLatin1String("white-space:break-spaces"));
+    }
+
+    QChar decode_entity(const QString& entity)
+    {
+        if (entity.startsWith("#x") || entity.startsWith("#X"))
+        {
+            bool ok{false};
+            auto code{entity.mid(2).toUInt(&ok, 16)};
+            return ok && code <= 0xffff ? QChar(code) : QChar();
+        }
+        if (entity.startsWith('#'))
+        {
+            bool ok{false};
+            auto code{entity.mid(1).toUInt(&ok, 10)};
+            return ok && code <= 0xffff ? QChar(code) : QChar();
+        }
+
+        if (entity == "amp")
+            return '&';
+        if (entity == "lt")
+            return '<';
+        if (entity == "gt")
+            return '>';
+        if (entity == "quot")
+            return '"';
+        if (entity == "apos")
+            return '\'';
+        if (entity == "nbsp")
+            return ' ';
+        return QChar();
+    }
+
+    QString normalize_line_endings(QString text)
+    {
+        text.replace(QLatin1String("\r\n"), QLatin1String("\n"));
+        text.replace('\r', '\n');
+        return text;
+    }
+
+    bool is_block(const QString& name)
+    {
+        static const QStringList blocks{"address", "article", "aside", "blockquote", "dd", "div", "dl", "dt", "figcaption",
+                                        "figure", "footer", "form", "h1", "h2", "h3", "h4", "h5", "h6", "header", "hr",
+                                        "li", "main", "nav", "ol", "p", "pre", "section", "table", "tr", "ul"};
+        return blocks.contains(name);
+    }
+} // namespace
+
+//------------------------------------------------
+// Factory methods
+
+Representation Representation::choose(const QString& text, const QString& html)
+{
+    Representation result;
+    result.text = text;
+
+    if (html.isEmpty())
+        return result;
+
+    auto minified{minify_html(html)};
+    if (minified.size() > html_budget)
+        // the text is the richest representation we are willing to send
+        return result;
+
+    result.html = minified;
+
+    // only if a receiver would get exactly the same text back; code from
+    // an IDE differs from its HTML only in indentation, and that matters
+    if (normalize_line_endings(html_to_text(minified)) == normalize_line_endings(text))
+        result.text.clear();
+
+    return result;
+}
+
+QString Representation::minify_html(const QString& html)
+{
+    static const QStringList raw_elements{"pre", "textarea", "script", "style"};
+
+    QString out;
+    out.reserve(html.size());
+
+    // the element whose style preserves whitespace, and how deeply
+    // elements of the same name are nested within it
+    QString preserved;
+    int preserved_depth{0};
+
+    bool space{false};
+    for (int i = 0; i < html.size();)
+    {
+        auto c{html[i]};
+
+        if (c == '<')
+        {
+            if (html.midRef(i, 4) == QLatin1String("<!--"))
+            {
+                auto end{html.indexOf("-->", i + 4)};
+                i = end < 0 ? html.size() : end + 3;
+                continue;
+            }
+
+            auto tag{parse_tag(html, i)};
+            if (tag.end > 0)
+            {
+                if (space && !out.isEmpty())
+                    out += ' ';
+                space = false;
+
+                auto text{html.midRef(i, tag.end - i)};
+                out += text;
+                i = tag.end;
+
+                if (preserved_depth)
+                {
+                    if (tag.name == preserved && !text.endsWith(QLatin1String("/>")))
+                        preserved_depth += tag.closing ? -1 : 1;
+                }
+                else if (!tag.closing && !tag.name.isEmpty() && !text.endsWith(QLatin1String("/>")) && preserves_whitespace(text))
+                {
+                    preserved = tag.name;
+                    preserved_depth = 1;
+                }
+
+                if (!tag.closing && raw_elements.contains(tag.name))
+                {
+                    auto end{find_closing(html, tag.name, i)};
+                    out += html.midRef(i, end - i);
+                    i = end;
+                }
+                continue;
+            }
+        }
+
+        if (is_html_space(c) && !preserved_depth)
+        {
+            space = true;
+            ++i;
+            continue;
+        }
+
+        if (space && !out.isEmpty())
+            out += ' ';
+        space = false;
+
+        out += c;
+        ++i;
+    }
+
+    return out;
+}
+
+QString Representation::html_to_text(const QString& html)
+{
+    static const QStringList skipped_elements{"head", "script", "style", "title", "noscript"};
+
+    QString text;
+    text.reserve(html.size() / 2);
+
+    // end the text with (at least) the given number of line breaks
+    auto line_breaks = [&text](int count) {
+        if (text.isEmpty())
+            return;
+        while (text.endsWith(' '))
+            text.chop(1);
+        auto existing{0};
+        while (existing < text.size() && text[text.size() - 1 - existing] == '\n')
+            ++existing;
+        for (; existing < count; ++existing)
+            text += '\n';
+    };
+
+    bool in_pre{false};
+    bool space{false};
+
+    auto append = [&](QChar c) {
+        if (space && !text.isEmpty() && !text.endsWith('\n') && !text.endsWith('\t'))
+            text += ' ';
+        space = false;
+        text += c;
+    };
+
+    for (int i = 0; i < html.size();)
+    {
+        auto c{html[i]};
+
+        if (c == '<')
+        {
+            if (html.midRef(i, 4) == QLatin1String("<!--"))
+            {
+                auto end{html.indexOf("-->", i + 4)};
+                i = end < 0 ? html.size() : end + 3;
+                continue;
+            }
+
+            auto tag{parse_tag(html, i)};
+            if (tag.end > 0)
+            {
+                i = tag.end;
+
+                if (!tag.closing && skipped_elements.contains(tag.name))
+                {
+                    i = find_closing(html, tag.name, i);
+                    continue;
+                }
+
+                if (tag.name == "pre")
+                    in_pre = !tag.closing;
+
+                if (tag.name == "br")
+                {
+                    text += '\n';
+                    space = false;
+                }
+                else if ((tag.name == "td" || tag.name == "th") && !tag.closing)
+                {
+                    if (!text.isEmpty() && !text.endsWith('\n'))
+                        text += '\t';
+                    space = false;
+                }
+                else if (is_block(tag.name))
+                {
+                    auto paragraph{tag.name == "p" || tag.name == "pre" || tag.name == "blockquote" || (tag.name.size() == 2 && tag.name[0] == 'h' && tag.name[1].isDigit())};
+                    line_breaks(paragraph ? 2 : 1);
+                    space = false;
+                }
+                continue;
+            }
+        }
+
+        if (c == '&')
+        {
+            auto end{html.indexOf(';', i + 1)};
+            if (end > 0 && end - i <= 10)
+            {
+                auto decoded{decode_entity(html.mid(i + 1, end - i - 1))};
+                if (!decoded.isNull())
+                {
+                    append(decoded);
+                    i = end + 1;
+                    continue;
+                }
+            }
+        }
+
+        if (is_html_space(c) && !in_pre)
+        {
+            space = true;
+            ++i;
+            continue;
+        }
+
+        if (in_pre)
+            text += c;
+        else
+            append(c);
+        ++i;
+    }
+
+    while (!text.isEmpty() && (text.endsWith('\n') || text.endsWith(' ')))
+        text.chop(1);
+
+    return text;
+}
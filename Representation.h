@@ -0,0 +1,51 @@
+#pragma once
+
+#include <QString>
+
+// Decides which representations of a clipboard snapshot go on the wire.
+//
+// Copies from browsers and word processors carry HTML that is often many
+// times the size of the plain text, and the text can usually be recovered
+// from the HTML.  In that case only the (minified) HTML is sent, and the
+// receiver derives the text when an application first asks for it.  The
+// text is sent as well unless deriving it reproduces it exactly (line
+// endings aside), and HTML larger than html_budget is not sent at all.
+
+struct Representation
+{
+    // characters of minified HTML worth sending alongside, or instead of, the text
+    static constexpr int html_budget{512 * 1024};
+
+    QString text;       // empty if receivers derive it from the HTML
+    QString html;
+
+    /*!
+    Choose what to send for a clipboard snapshot.
+
+    \param text The plain text of the snapshot.
+    \param html The HTML of the snapshot, if any.
+    \returns The representations to send.
+    */
+    static Representation choose(const QString& text, const QString& html);
+
+    /*!
+    Collapse the whitespace that does not affect rendering and drop
+    comments.  The contents of pre, textarea, script and style elements,
+    and of elements styled "white-space: pre" (or pre-wrap, pre-line or
+    break-spaces), are left alone.
+
+    \param html The HTML to minify.
+    \returns The minified HTML.
+    */
+    static QString minify_html(const QString& html);
+
+    /*!
+    Derive the plain text of an HTML fragment the way a browser's copy
+    would: tags are removed, block elements break lines, table cells are
+    separated by tabs and character references are decoded.
+
+    \param html The HTML to convert.
+    \returns The plain text.
+    */
+    static QString html_to_text(const QString& html);
+};
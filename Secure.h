@@ -1,60 +1,30 @@
 #pragma once
 
 #include <cstdint>
-#include <memory>
-#include <string>
 #include <vector>
 
 #include <QObject>
 #include <QByteArray>
 #include <QSharedPointer>
 
-#ifdef CRYPTOPP
-// Crypto++
-#include "modes.h"
-#include "aes.h"
-#include "filters.h"
-#include "osrng.h"
-#include "hex.h"
-
-const int MaxKeySize = 32U; // maximum of 256 bits (32 * 8) for key
-#endif
-
-#ifdef SIMPLECRYPT
-#include "SimpleCrypt.h"
-#endif
+#include "CryptoBackend.h"
+#include "SipHash.h"
 
 class Secure;
 using secure_ptr_t = QSharedPointer<Secure>;
 
+// The keys one passphrase yields: one for each cipher the build includes
+// (see CryptoBackend.h), of which one is chosen for encrypting, plus the
+// group tag and header MAC key.  The latter two are derived from the
+// passphrase alone, so members that send with different ciphers still
+// recognize each other's packets.
+
 class Secure : public QObject
 {
     Q_OBJECT
 
-public: // aliases and enums
-#ifdef CRYPTOPP
-    // clang-format off
-    // only use AES + SHA256 + CryptoPP::CFB for now; it is a step above
-    // the obfuscation of SimpleCrypt.  if you feel your data requires
-    // more industrial strength encryption than AES/SHA256, you can convert
-    // this to something heavier.
-    enum class Cipher
-    {
-        aes,        // The advanced encryption standard symmetric encryption algorithm. Standard: FIPS 197
-    };
-
-    enum class Hash
-    {
-        sha256,     // The 256-bit secure hash algorithm. Standard: FIPS 180-2, FIPS 198.
-    };
-    // clang-format on
-#endif
-
 public:
-#ifdef CRYPTOPP
-    explicit Secure(const Cipher cipher = Cipher::aes, QObject* parent = nullptr);
-#endif
-    explicit Secure(const QString& cipher = "AES", QObject* parent = nullptr);
+    explicit Secure(crypto::Cipher cipher = crypto::fastest(), QObject* parent = nullptr);
     ~Secure();
 
     /*!
@@ -63,38 +33,33 @@ public:
     key value, and then generates a Secure instance configured
     for it.
 
-    \param passphrase A text string representing the passphrase.
-    \param cipher The cipher to use.
-    \param hash The hash algorithm to use when generating the key.
+    \param passphrase A text string representing the passphrase, or the path of a key file.
+    \param cipher The name of the cipher to encrypt with (see crypto::name()), or "auto" for the fastest on this machine.
     \returns A shared pointer to the Secure instance based on the arguments.
     */
-    static secure_ptr_t create(const QString& passphrase, const QString& cipher = "AES", const QString& hash = "SHA256");
+    static secure_ptr_t create(const QString& passphrase, const QString& cipher = "auto");
 
     /*!
-    Set the passphrase value that will be used as the basis of key
-    that will be used by the encryption and decryption actions.
+    Set the key material every cipher derives its key from.
 
-    \param passphrase A text string representing the passphrase.
-    \param hash The hash algorithm to use when generating the key.
-    \returns A Boolean true if the key value was successfully generated.
+    \param key_material The passphrase, or the contents of the key file it names.
+    \returns A Boolean true if the cipher chosen for encrypting was keyed.
     */
-#ifdef CRYPTOPP
-    bool set_key(const QByteArray& passphrase, Hash hash = Hash::sha256);
-#endif
+    bool set_key(const QByteArray& key_material);
 
-    /*!
-    Set the passphrase value that will be used as the basis of key
-    that will be used by the encryption and decryption actions.
+    // the cipher encrypt() uses; a packet header names it for receivers
+    crypto::Cipher cipher() const { return m_cipher; }
 
-    \param passphrase A text string representing the passphrase.
-    \param hash A string version of the hash algorithm to use when generating the key.
-    \returns A Boolean true if the key value was successfully generated.
+    /*!
+    \param cipher A cipher named by a received packet.
+    \returns A Boolean true if this build can decrypt it.
     */
-    bool set_key(const QByteArray& passphrase, const QString& hash_str = "AES");
+    bool supports(crypto::Cipher cipher) const { return backend(cipher) != nullptr; }
 
     /*!
     Encrypt a buffer of data.  On success, the encrypted version of
-    the data is returned as a separate buffer.
+    the data is returned as a separate buffer.  Once the key is set,
+    encrypt() and decrypt() may be called from several threads at once.
 
     \param in_buffer The data to be encrypted.
     \param success A Boolean value that will be set with the result of the encryption attempt.
@@ -108,62 +73,42 @@ public:
     the data is returned as a separate buffer.
 
     \param in_buffer The data to be decrypted.
+    \param cipher The cipher the data was encrypted with; cipher() if not given.
     \param success A Boolean value that will be set with the result of the decryption attempt.
     \returns A buffer that contains the successfully decrypted data.
     */
     QByteArray decrypt(const QByteArray& in_buffer, bool& success);
+    QByteArray decrypt(const QByteArray& in_buffer, crypto::Cipher cipher, bool& success);
 
-private: // aliases and enums
-#ifdef CRYPTOPP
-    // we are using CFB mode for simplicity (it is still stronger encryption
-    // than SimpleCrypt).  you can go as far down the Crypto++ rabbit hole
-    // as your heart desires, but this simplified AES encryption should be
-    // more than sufficient.
-
-    using cfb_aes_encryptor_ptr_t = std::unique_ptr<CryptoPP::CFB_Mode<CryptoPP::AES>::Encryption>;
-    using cfb_aes_decryptor_ptr_t = std::unique_ptr<CryptoPP::CFB_Mode<CryptoPP::AES>::Decryption>;
-#endif
+    /*!
+    A short value derived from the key that every member of the group
+    shares.  Packets carrying a different tag were produced with a
+    different passphrase (or by another group) and can be discarded
+    without being decrypted.
 
-#ifdef SIMPLECRYPT
-    using simplecrypt_ptr_t = std::unique_ptr<SimpleCrypt>;
-#endif
+    \returns The group tag for the current key.
+    */
+    uint32_t group_tag() const { return m_group_tag; }
 
-private: // methods
-    void init();
-    void close();
+    /*!
+    The SipHash key, derived from the current key, that is used to
+    authenticate packet headers before any bulk decryption is attempted.
 
-#ifdef SIMPLECRYPT
-    quint64 sixty_four_hash(const QString& str);
-#endif
+    \returns A pointer to siphash::key_size bytes of key material.
+    */
+    const uint8_t* filter_key() const { return m_filter_key; }
 
-#ifdef OBFUSCATION
-    QByteArray newKey(int seed, int start, int end);
-    QByteArray newDoyKey();
-    QByteArray newHourKey();
-    QByteArray newMonthKey();
-#endif
+private: // methods
+    const crypto::Backend* backend(crypto::Cipher cipher) const;
 
-#if 0
-    void print_hex(const uint8_t* data, size_t len);
-#endif
+    void derive_filter_key(const QByteArray& key_material);
 
 private: // data members
-#ifdef CRYPTOPP
-    CryptoPP::byte m_key[MaxKeySize]{0};
-    CryptoPP::byte m_iv[CryptoPP::AES::BLOCKSIZE]{0};
-
-    cfb_aes_encryptor_ptr_t m_cfbEncryption{nullptr};
-    cfb_aes_decryptor_ptr_t m_cfbDecryption{nullptr};
-
-    Cipher m_cipher{Cipher::aes};
-    Hash m_hash{Hash::sha256};
-#endif
+    crypto::Cipher m_cipher{crypto::Cipher::none};
 
-#ifdef SIMPLECRYPT
-    simplecrypt_ptr_t m_simplecrypt;
-#endif
+    // one per cipher the build includes, all keyed by set_key()
+    std::vector<crypto::backend_ptr_t> m_backends;
 
-#ifdef OBFUSCATION
-    QByteArray passphrase;
-#endif
+    uint8_t m_filter_key[siphash::key_size]{0};
+    uint32_t m_group_tag{0};
 };
@@ -15,14 +15,18 @@ Sender::Sender(uint16_t group_port, const QString& ipv4_group, const QString& ip
     m_udp_socket_ipv4.setSocketOption(QAbstractSocket::MulticastTtlOption, 1);
 }
 
-void Sender::send_datagram(const QByteArray& datagram)
+bool Sender::send_datagram(const QByteArray& datagram)
 {
+    bool success{true};
+
     if (!m_group_address_ipv4.toString().isEmpty())
-        m_udp_socket_ipv4.writeDatagram(datagram, m_group_address_ipv4, m_group_port);
+        success &= (m_udp_socket_ipv4.writeDatagram(datagram, m_group_address_ipv4, m_group_port) == datagram.size());
 
     if (!m_group_address_ipv6.toString().isEmpty())
     {
         if (m_udp_socket_ipv6.state() == QAbstractSocket::BoundState)
-            m_udp_socket_ipv6.writeDatagram(datagram, m_group_address_ipv6, m_group_port);
+            success &= (m_udp_socket_ipv6.writeDatagram(datagram, m_group_address_ipv6, m_group_port) == datagram.size());
     }
+
+    return success;
 }
@@ -11,11 +11,15 @@ class Sender : public QObject
 public:
     explicit Sender(uint16_t group_port, const QString& ipv4_group, const QString& ipv6_group, QObject* parent = nullptr);
 
-    void send_datagram(const QByteArray& datagram);
+    /*!
+    Multicast a datagram to every configured group.
 
-private:
-    QTimer timer;
+    \param datagram The complete datagram to send.
+    \returns A Boolean true if every configured group accepted the datagram.
+    */
+    bool send_datagram(const QByteArray& datagram);
 
+private:
     QUdpSocket m_udp_socket_ipv4;
     QUdpSocket m_udp_socket_ipv6;
 
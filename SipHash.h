@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// SipHash-2-4 (Aumasson & Bernstein), a fast keyed hash with a 128-bit key
+// and 64-bit output.  It is used to tag packet headers so that datagrams
+// produced with a different key can be rejected without decrypting them.
+
+namespace siphash
+{
+    constexpr size_t key_size{16};
+
+    inline uint64_t rotl(uint64_t x, int b) { return (x << b) | (x >> (64 - b)); }
+
+    inline uint64_t load64(const uint8_t* p)
+    {
+        uint64_t v{0};
+        for (int i = 7; i >= 0; --i)
+            v = (v << 8) | p[i];
+        return v;
+    }
+
+    inline void round(uint64_t& v0, uint64_t& v1, uint64_t& v2, uint64_t& v3)
+    {
+        v0 += v1;
+        v1 = rotl(v1, 13);
+        v1 ^= v0;
+        v0 = rotl(v0, 32);
+        v2 += v3;
+        v3 = rotl(v3, 16);
+        v3 ^= v2;
+        v0 += v3;
+        v3 = rotl(v3, 21);
+        v3 ^= v0;
+        v2 += v1;
+        v1 = rotl(v1, 17);
+        v1 ^= v2;
+        v2 = rotl(v2, 32);
+    }
+
+    /*!
+    Compute the SipHash-2-4 of a buffer.
+
+    \param key The 16-byte key.
+    \param data The data to hash.
+    \param size The number of bytes in data.
+    \returns The 64-bit hash value.
+    */
+    inline uint64_t hash(const uint8_t* key, const uint8_t* data, size_t size)
+    {
+        auto k0{load64(key)};
+        auto k1{load64(key + 8)};
+
+        uint64_t v0{0x736f6d6570736575ULL ^ k0};
+        uint64_t v1{0x646f72616e646f6dULL ^ k1};
+        uint64_t v2{0x6c7967656e657261ULL ^ k0};
+        uint64_t v3{0x7465646279746573ULL ^ k1};
+
+        auto end{data + (size - (size % 8))};
+        for (auto p = data; p != end; p += 8)
+        {
+            auto m{load64(p)};
+            v3 ^= m;
+            round(v0, v1, v2, v3);
+            round(v0, v1, v2, v3);
+            v0 ^= m;
+        }
+
+        uint64_t b{static_cast<uint64_t>(size) << 56};
+        for (size_t i = 0; i < size % 8; ++i)
+            b |= static_cast<uint64_t>(end[i]) << (8 * i);
+
+        v3 ^= b;
+        round(v0, v1, v2, v3);
+        round(v0, v1, v2, v3);
+        v0 ^= b;
+
+        v2 ^= 0xff;
+        for (int i = 0; i < 4; ++i)
+            round(v0, v1, v2, v3);
+
+        return v0 ^ v1 ^ v2 ^ v3;
+    }
+} // namespace siphash
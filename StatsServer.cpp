@@ -0,0 +1,62 @@
+#include <QDir>
+#include <QLocalSocket>
+#include <QJsonDocument>
+#include <QStandardPaths>
+
+#include "StatsServer.h"
+
+// how long a socket left behind is given to answer before it is taken over
+static const int probe_timeout_ms = 250;
+
+StatsServer::StatsServer(snapshot_t snapshot, QObject* parent) : QObject(parent), m_snapshot(std::move(snapshot))
+{
+    m_server.setSocketOptions(QLocalServer::UserAccessOption);
+    connect(&m_server, &QLocalServer::newConnection, this, &StatsServer::slot_new_connection);
+}
+
+StatsServer::~StatsServer()
+{
+    m_server.close();
+}
+
+bool StatsServer::listen()
+{
+    QString name;
+#ifdef QT_WIN
+    name = "clipnet-stats";
+#else
+    auto runtime_dir{QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation)};
+    if (runtime_dir.isEmpty())
+        runtime_dir = QDir::tempPath();
+    name = QDir(runtime_dir).filePath("clipnet-stats.sock");
+#endif
+
+    m_error.clear();
+
+    // a socket that answers belongs to a running instance, which keeps it;
+    // one that does not was left behind by a crashed one
+    QLocalSocket probe;
+    probe.connectToServer(name);
+    if (probe.waitForConnected(probe_timeout_ms))
+    {
+        probe.abort();
+        m_error = tr("%1 is served by another running instance").arg(name);
+        return false;
+    }
+
+    QLocalServer::removeServer(name);
+
+    return m_server.listen(name);
+}
+
+void StatsServer::slot_new_connection()
+{
+    while (auto socket = m_server.nextPendingConnection())
+    {
+        connect(socket, &QLocalSocket::disconnected, socket, &QLocalSocket::deleteLater);
+
+        socket->write(QJsonDocument(m_snapshot()).toJson(QJsonDocument::Compact));
+        socket->write("\n");
+        socket->disconnectFromServer();
+    }
+}
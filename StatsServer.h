@@ -0,0 +1,49 @@
+#pragma once
+
+#include <functional>
+
+#include <QObject>
+#include <QJsonObject>
+#include <QLocalServer>
+
+// Serves a JSON snapshot of the pipeline statistics on a local socket (a
+// Unix domain socket on Linux/macOS, a named pipe on Windows).  Every
+// connection receives one snapshot, terminated by a newline, and is then
+// closed, so "socat - UNIX-CONNECT:<path>" is all a scraper needs.
+
+class StatsServer : public QObject
+{
+    Q_OBJECT
+
+public: // aliases and enums
+    using snapshot_t = std::function<QJsonObject()>;
+
+public:
+    explicit StatsServer(snapshot_t snapshot, QObject* parent = nullptr);
+    ~StatsServer();
+
+    /*!
+    Start listening on the default location for this user, unless
+    another instance is serving there already.
+
+    \returns A Boolean true if the socket is listening.
+    */
+    bool listen();
+
+    /*!
+    \returns The full path (or pipe name) scrapers should connect to.
+    */
+    QString server_path() const { return m_server.fullServerName(); }
+
+    QString error_string() const { return m_error.isEmpty() ? m_server.errorString() : m_error; }
+
+    bool is_listening() const { return m_server.isListening(); }
+
+private slots:
+    void slot_new_connection();
+
+private: // data members
+    QLocalServer m_server;
+    snapshot_t m_snapshot;
+    QString m_error;    // why listen() did not try, if it did not
+};
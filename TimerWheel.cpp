@@ -0,0 +1,163 @@
+#include <limits>
+#include <algorithm>
+
+#include "TimerWheel.h"
+
+static constexpr int64_t slot_mask{TimerWheel::slot_count - 1};
+
+TimerWheel::TimerWheel(QObject* parent) : QObject(parent)
+{
+    m_clock.start();
+
+    m_timer.setSingleShot(true);
+    m_timer.callOnTimeout(this, &TimerWheel::slot_expired);
+}
+
+TimerWheel::timer_id_t TimerWheel::schedule(int delay_ms, QObject* context, callback_t callback)
+{
+    // with nothing pending, the ticks since the last one need no processing
+    if (m_entries.empty())
+        m_tick = std::max(m_tick, now_tick());
+
+    Entry entry;
+    entry.deadline = std::max((m_clock.elapsed() + std::max(delay_ms, 0) + tick_ms - 1) / tick_ms, m_tick + 1);
+    entry.callback = std::move(callback);
+    entry.context = context;
+    entry.guarded = context != nullptr;
+
+    auto id{++m_last_id};
+    insert(id, entry);
+    m_entries.emplace(id, std::move(entry));
+
+    rearm();
+    return id;
+}
+
+bool TimerWheel::cancel(timer_id_t id)
+{
+    auto iter{m_entries.find(id)};
+    if (iter == m_entries.end())
+        return false;
+
+    // an entry that is due is no longer in its slot
+    auto& slot{m_slots[static_cast<size_t>(iter->second.level)][static_cast<size_t>(iter->second.slot)]};
+    auto position{std::find(slot.begin(), slot.end(), id)};
+    if (position != slot.end())
+        slot.erase(position);
+
+    m_entries.erase(iter);
+
+    rearm();
+    return true;
+}
+
+void TimerWheel::slot_expired()
+{
+    advance(now_tick());
+    rearm();
+}
+
+void TimerWheel::insert(timer_id_t id, Entry& entry)
+{
+    auto delta{entry.deadline - m_tick};
+
+    auto level{0};
+    while (level < level_count - 1 && delta >= (int64_t{1} << (slot_bits * (level + 1))))
+        ++level;
+
+    // beyond the top level's reach, the entry waits in its last slot and
+    // is placed again when that comes round
+    auto position{std::min(entry.deadline, m_tick + (int64_t{1} << (slot_bits * level_count)) - 1)};
+
+    entry.level = level;
+    entry.slot = static_cast<int>((position >> (slot_bits * level)) & slot_mask);
+    m_slots[static_cast<size_t>(level)][static_cast<size_t>(entry.slot)].push_back(id);
+}
+
+void TimerWheel::cascade(int level, int slot)
+{
+    slot_t moving;
+    moving.swap(m_slots[static_cast<size_t>(level)][static_cast<size_t>(slot)]);
+
+    for (auto id : moving)
+        insert(id, m_entries[id]);
+}
+
+void TimerWheel::advance(int64_t tick)
+{
+    m_advancing = true;
+
+    while (m_tick < tick)
+    {
+        if (m_entries.empty())
+        {
+            m_tick = tick;
+            break;
+        }
+
+        ++m_tick;
+
+        for (auto level = 1; level < level_count; ++level)
+        {
+            auto shift{slot_bits * level};
+            if (m_tick & ((int64_t{1} << shift) - 1))
+                break;
+            cascade(level, static_cast<int>((m_tick >> shift) & slot_mask));
+        }
+
+        slot_t due;
+        due.swap(m_slots[0][static_cast<size_t>(m_tick & slot_mask)]);
+
+        for (auto id : due)
+        {
+            // an earlier callback may have cancelled it
+            auto iter{m_entries.find(id)};
+            if (iter == m_entries.end())
+                continue;
+
+            auto entry{std::move(iter->second)};
+            m_entries.erase(iter);
+
+            if (entry.guarded && !entry.context)
+                continue;
+
+            entry.callback();
+        }
+    }
+
+    m_advancing = false;
+}
+
+void TimerWheel::rearm()
+{
+    // callbacks (re)scheduling during advance() leave it to slot_expired()
+    if (m_advancing)
+        return;
+
+    if (m_entries.empty())
+    {
+        m_timer.stop();
+        return;
+    }
+
+    // level 0 gives the exact tick of its earliest entry; a higher level
+    // gives the tick its earliest slot falls into the levels below
+    auto next{std::numeric_limits<int64_t>::max()};
+    for (auto level = 0; level < level_count; ++level)
+    {
+        auto shift{slot_bits * level};
+        auto base{m_tick >> shift};
+
+        for (auto distance = 1; distance <= slot_count; ++distance)
+        {
+            if (!m_slots[static_cast<size_t>(level)][static_cast<size_t>((base + distance) & slot_mask)].empty())
+            {
+                next = std::min(next, (base + distance) << shift);
+                break;
+            }
+        }
+    }
+
+    auto wait{next * tick_ms - m_clock.elapsed()};
+    m_timer.start(static_cast<int>(std::max<int64_t>(std::min<int64_t>(wait, std::numeric_limits<int>::max()), 0)));
+}
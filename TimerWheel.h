@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+#include <QTimer>
+#include <QObject>
+#include <QPointer>
+#include <QElapsedTimer>
+
+// A hierarchical timer wheel: every deadline the GUI thread keeps (clearing
+// the clipboard, giving up on a reassembly, the apply window, polls, cues)
+// is an entry here, and a single QTimer is set for the earliest of them.
+// With nothing scheduled the QTimer is stopped, so an idle process is not
+// woken at all.
+//
+// Deadlines are kept to tick_ms.  Level 0 holds the deadlines within
+// slot_count ticks, one slot per tick; each level above covers slot_count
+// times the span of the one below, and its entries fall into the lower
+// levels as their slot comes round (four levels reach about 46 hours).
+// Scheduling and cancelling take constant time.
+
+class TimerWheel : public QObject
+{
+    Q_OBJECT
+
+public: // aliases and enums
+    using timer_id_t = uint64_t;    // zero is never a valid id
+    using callback_t = std::function<void()>;
+
+    static constexpr int tick_ms{10};
+    static constexpr int slot_bits{6};
+    static constexpr int slot_count{1 << slot_bits};
+    static constexpr int level_count{4};
+
+public:
+    explicit TimerWheel(QObject* parent = nullptr);
+
+    /*!
+    Schedule a callback.
+
+    \param delay_ms How long from now the callback is due.
+    \param context The callback is dropped if this object is destroyed first; may be null.
+    \param callback The function to call on the GUI thread.
+    \returns The id of the timer, for cancel().
+    */
+    timer_id_t schedule(int delay_ms, QObject* context, callback_t callback);
+
+    /*!
+    Cancel a scheduled callback.  Cancelling a timer that has already
+    fired (or the zero id) does nothing.
+
+    \param id The id returned by schedule().
+    \returns A Boolean true if the timer was still pending.
+    */
+    bool cancel(timer_id_t id);
+
+    bool is_pending(timer_id_t id) const { return id && m_entries.count(id); }
+
+    size_t pending() const { return m_entries.size(); }
+
+private slots:
+    void slot_expired();
+
+private: // aliases and enums
+    struct Entry
+    {
+        int64_t deadline{0};        // in ticks
+        callback_t callback;
+        QPointer<QObject> context;
+        bool guarded{false};        // context was given
+        int level{0};
+        int slot{0};
+    };
+
+    using slot_t = std::vector<timer_id_t>;
+
+private: // methods
+    int64_t now_tick() const { return m_clock.elapsed() / tick_ms; }
+
+    void insert(timer_id_t id, Entry& entry);
+    void cascade(int level, int slot);
+    void advance(int64_t tick);
+    void rearm();
+
+private: // data members
+    QElapsedTimer m_clock;
+    QTimer m_timer;
+
+    int64_t m_tick{0};              // every tick up to this one has been processed
+    timer_id_t m_last_id{0};
+    bool m_advancing{false};
+
+    std::unordered_map<timer_id_t, Entry> m_entries;
+    std::array<std::array<slot_t, slot_count>, level_count> m_slots;
+};
@@ -0,0 +1,147 @@
+#include <thread>
+#include <functional>
+
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonDocument>
+
+#include "Trace.h"
+
+std::atomic<bool> Trace::s_enabled{false};
+
+//------------------------------------------------
+// Factory methods
+
+Trace& Trace::instance()
+{
+    static Trace trace;
+    return trace;
+}
+
+//------------------------------------------------
+// Instance methods
+
+Trace::Trace()
+{
+    using namespace std::chrono;
+    auto wall{duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count()};
+    m_wall_offset_ns = static_cast<int64_t>(wall) - static_cast<int64_t>(now_ns());
+}
+
+static uint32_t thread_tag()
+{
+    thread_local uint32_t tag{static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id()) & 0xffffff)};
+    return tag;
+}
+
+void Trace::record(Stage stage, uint64_t start_ns, uint64_t end_ns, int sender, uint32_t message_id)
+{
+    auto index{m_head.fetch_add(1, std::memory_order_relaxed)};
+    auto& slot{m_slots[index & (capacity - 1)]};
+
+    auto duration{static_cast<uint32_t>(qMin<uint64_t>(end_ns - start_ns, 0xffffffff))};
+
+    slot.sequence.store(index * 2 + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.start_ns.store(start_ns, std::memory_order_relaxed);
+    slot.duration_and_id.store((uint64_t(duration) << 32) | message_id, std::memory_order_relaxed);
+    slot.sender_thread_stage.store(
+        (uint64_t(static_cast<uint32_t>(sender)) << 32) | (uint64_t(thread_tag()) << 8) | static_cast<uint8_t>(stage), std::memory_order_relaxed);
+
+    slot.sequence.store(index * 2 + 2, std::memory_order_release);
+}
+
+QByteArray Trace::export_chrome_json(int process_id, const QString& process_name) const
+{
+    QJsonArray events;
+
+    QJsonObject metadata;
+    metadata["name"] = "process_name";
+    metadata["ph"] = "M";
+    metadata["pid"] = process_id;
+    metadata["args"] = QJsonObject{{"name", process_name}};
+    events.append(metadata);
+
+    auto head{m_head.load(std::memory_order_acquire)};
+    auto first{head > capacity ? head - capacity : 0};
+
+    for (auto index = first; index < head; ++index)
+    {
+        const auto& slot{m_slots[index & (capacity - 1)]};
+
+        auto before{slot.sequence.load(std::memory_order_acquire)};
+        auto start_ns{slot.start_ns.load(std::memory_order_relaxed)};
+        auto duration_and_id{slot.duration_and_id.load(std::memory_order_relaxed)};
+        auto sender_thread_stage{slot.sender_thread_stage.load(std::memory_order_relaxed)};
+        std::atomic_thread_fence(std::memory_order_acquire);
+        auto after{slot.sequence.load(std::memory_order_relaxed)};
+
+        // torn, still being written, or already overwritten by a newer span
+        if (before != after || before != index * 2 + 2)
+            continue;
+
+        auto stage{static_cast<Stage>(sender_thread_stage & 0xff)};
+        auto sender{static_cast<int>(sender_thread_stage >> 32)};
+        auto message_id{static_cast<uint32_t>(duration_and_id & 0xffffffff)};
+
+        QJsonObject event;
+        event["name"] = name(stage);
+        event["cat"] = "clipnet";
+        event["ph"] = "X";
+        event["pid"] = process_id;
+        event["tid"] = static_cast<int>((sender_thread_stage >> 8) & 0xffffff);
+        event["ts"] = static_cast<double>(static_cast<int64_t>(start_ns) + m_wall_offset_ns) / 1000.0;
+        event["dur"] = static_cast<double>(duration_and_id >> 32) / 1000.0;
+
+        if (sender || message_id)
+        {
+            // "<sender>:<message>" is the same on every peer that handled the copy
+            event["args"] = QJsonObject{{"message", QString("%1:%2").arg(static_cast<uint32_t>(sender), 0, 16).arg(message_id)}};
+        }
+
+        events.append(event);
+    }
+
+    QJsonObject document;
+    document["traceEvents"] = events;
+    document["displayTimeUnit"] = "ns";
+
+    return QJsonDocument(document).toJson(QJsonDocument::Compact);
+}
+
+const char* Trace::name(Stage stage)
+{
+    switch (stage)
+    {
+        case Stage::ReadClipboard:
+            return "read_clipboard";
+        case Stage::Snapshot:
+            return "snapshot";
+        case Stage::Serialize:
+            return "serialize";
+        case Stage::Encrypt:
+            return "encrypt";
+        case Stage::Send:
+            return "send";
+        case Stage::Receive:
+            return "receive";
+        case Stage::PeerEvent:
+            return "peer_event";
+        case Stage::Verify:
+            return "verify";
+        case Stage::Decrypt:
+            return "decrypt";
+        case Stage::Parse:
+            return "parse";
+        case Stage::Apply:
+            return "apply";
+        case Stage::Compress:
+            return "compress";
+        case Stage::Decompress:
+            return "decompress";
+        default:
+            break;
+    }
+    return "unknown";
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include <QByteArray>
+
+// High-resolution span tracing for the sync pipeline.  Spans are written
+// into a fixed-size, lock-free ring (the oldest spans are overwritten) and
+// can be exported on demand in the Chrome trace event format, which both
+// chrome://tracing and Perfetto load directly.
+//
+// Spans carry the sender id and message id of the clipboard event they
+// belong to, so traces exported from several peers can be merged and a
+// single copy followed from one machine to the next.
+//
+// While tracing is disabled, a TraceScope costs a single relaxed load.
+
+class Trace
+{
+public: // aliases and enums
+    enum class Stage : uint8_t
+    {
+        ReadClipboard,  // slot_read_clipboard, end to end
+        Snapshot,       // pulling the formats off the clipboard
+        Serialize,      // building the JSON payload
+        Encrypt,
+        Send,           // writeDatagram
+        Receive,        // Receiver::slot_process_datagrams, per datagram
+        PeerEvent,      // slot_process_peer_event, end to end
+        Verify,         // group tag / header MAC check
+        Decrypt,
+        Parse,
+        Apply,          // QClipboard::setMimeData
+        Compress,       // qCompress of a large outgoing payload
+        Decompress,     // inflating a compressed copy when it is first pasted
+
+        Count
+    };
+
+    // must be a power of two
+    static constexpr size_t capacity{65536};
+
+public:
+    static Trace& instance();
+
+    static bool enabled() { return s_enabled.load(std::memory_order_relaxed); }
+    static void set_enabled(bool enabled) { s_enabled.store(enabled, std::memory_order_relaxed); }
+
+    static uint64_t now_ns()
+    {
+        using namespace std::chrono;
+        return static_cast<uint64_t>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+    }
+
+    /*!
+    Append a completed span to the ring.  Safe to call from any thread.
+
+    \param stage The pipeline stage the span measured.
+    \param start_ns The start of the span, from now_ns().
+    \param end_ns The end of the span, from now_ns().
+    \param sender The sender id of the message being processed, if known.
+    \param message_id The sender-local id of the message being processed, if known.
+    */
+    void record(Stage stage, uint64_t start_ns, uint64_t end_ns, int sender, uint32_t message_id);
+
+    /*!
+    Render the spans currently in the ring as Chrome trace event JSON.
+
+    \param process_id The id used for the "pid" of every event (normally our sender id).
+    \param process_name A human-readable name for this process (normally the host name).
+    \returns The JSON document.
+    */
+    QByteArray export_chrome_json(int process_id, const QString& process_name) const;
+
+    static const char* name(Stage stage);
+
+private:
+    Trace();
+
+    // a seqlock-protected slot; all fields are atomics so readers racing
+    // with writers see torn slots (and skip them) rather than UB
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence{0}; // odd while being written
+        std::atomic<uint64_t> start_ns{0};
+        std::atomic<uint64_t> duration_and_id{0};
+        std::atomic<uint64_t> sender_thread_stage{0};
+    };
+
+private: // data members
+    static std::atomic<bool> s_enabled;
+
+    std::atomic<uint64_t> m_head{0};
+    std::array<Slot, capacity> m_slots;
+
+    // converts steady-clock spans to wall-clock time for cross-machine merging
+    int64_t m_wall_offset_ns{0};
+};
+
+class TraceScope
+{
+public:
+    explicit TraceScope(Trace::Stage stage, int sender = 0, uint32_t message_id = 0) :
+        m_stage(stage), m_sender(sender), m_message_id(message_id), m_start_ns(Trace::enabled() ? Trace::now_ns() : 0)
+    {}
+
+    ~TraceScope()
+    {
+        if (m_start_ns)
+            Trace::instance().record(m_stage, m_start_ns, Trace::now_ns(), m_sender, m_message_id);
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    // for spans that learn which message they belong to part way through
+    void set_message(int sender, uint32_t message_id)
+    {
+        m_sender = sender;
+        m_message_id = message_id;
+    }
+
+private:
+    Trace::Stage m_stage;
+    int m_sender{0};
+    uint32_t m_message_id{0};
+    uint64_t m_start_ns{0};
+};
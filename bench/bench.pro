@@ -0,0 +1,12 @@
+# ClipNet benchmark harnesses.  Every backend built in is measured by
+# one binary; secure covers them all, and loopback takes --cipher:
+#
+#   qmake "CONFIG+=cryptopp simplecrypt obfuscate" && make
+#   ./secure/secure > secure.jsonl
+#   ./loopback/loopback --cipher aes-gcm > aes-gcm.jsonl
+
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    loopback \
+    secure
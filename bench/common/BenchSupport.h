@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <QString>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QTextStream>
+
+// Small helpers shared by the ClipNet benchmark harnesses.  Results are
+// emitted as one JSON object per line so runs from different commits can
+// be collected and compared with ordinary tooling (jq, pandas, etc.).
+
+namespace bench
+{
+    // incremented by the replacement operator new in AllocCounter.cpp
+    extern std::atomic<uint64_t> allocations;
+
+    inline uint64_t allocation_count() { return allocations.load(std::memory_order_relaxed); }
+
+    inline uint64_t now_ns()
+    {
+        using namespace std::chrono;
+        return static_cast<uint64_t>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+    }
+
+    // returns true if cycle counts are meaningful on this platform
+    inline bool have_cycle_counter()
+    {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    inline uint64_t cycles()
+    {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return now_ns();
+#endif
+    }
+
+    /*!
+    Nearest-rank percentile of a sample set.  The samples are sorted
+    in place.
+
+    \param samples The sample values.
+    \param p The percentile, in the range [0, 1].
+    \returns The sample at the requested rank, or 0 for an empty set.
+    */
+    inline double percentile(std::vector<double>& samples, double p)
+    {
+        if (samples.empty())
+            return 0.0;
+
+        std::sort(samples.begin(), samples.end());
+        auto rank{static_cast<size_t>(p * static_cast<double>(samples.size() - 1) + 0.5)};
+        return samples[std::min(rank, samples.size() - 1)];
+    }
+
+    inline void emit_result(const QJsonObject& result)
+    {
+        static QTextStream out(stdout);
+        out << QJsonDocument(result).toJson(QJsonDocument::Compact) << "\n";
+        out.flush();
+    }
+} // namespace bench
@@ -0,0 +1,32 @@
+# Settings shared by every ClipNet benchmark harness.
+
+QT -= gui
+QT += core
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+# benchmarks are only meaningful against optimized code
+CONFIG -= debug
+CONFIG += release
+
+# use the same (pseudo-)cryptographic poison as the application;
+# override with "qmake CONFIG+=simplecrypt" (or obfuscate), or add
+# them to cryptopp to measure them all in one binary
+!simplecrypt:!obfuscate {
+    CONFIG += cryptopp
+}
+
+include($$PWD/../../crypto.pri)
+
+INCLUDEPATH += $$PWD $$CLIPNET_ROOT
+
+SOURCES += $$PWD/AllocCounter.cpp
+HEADERS += $$PWD/BenchSupport.h
+
+SOURCES += $$CLIPNET_ROOT/CryptoBackend.cpp $$CLIPNET_ROOT/Secure.cpp
+HEADERS += $$CLIPNET_ROOT/CryptoBackend.h $$CLIPNET_ROOT/Secure.h
+
+INTERMEDIATE_NAME = intermediate
+MOC_DIR = $$INTERMEDIATE_NAME/moc
+OBJECTS_DIR = $$INTERMEDIATE_NAME/obj
@@ -0,0 +1,26 @@
+# End-to-end copy-to-clipboard latency and throughput over loopback multicast.
+
+TARGET = loopback
+
+include(../common/common.pri)
+
+QT += network
+
+SOURCES += \
+    main.cpp \
+    $$CLIPNET_ROOT/ClipMimeData.cpp \
+    $$CLIPNET_ROOT/Payload.cpp \
+    $$CLIPNET_ROOT/Receiver.cpp \
+    $$CLIPNET_ROOT/Representation.cpp \
+    $$CLIPNET_ROOT/Sender.cpp \
+    $$CLIPNET_ROOT/Trace.cpp
+
+HEADERS += \
+    $$CLIPNET_ROOT/ClipMimeData.h \
+    $$CLIPNET_ROOT/HistoryIndex.h \
+    $$CLIPNET_ROOT/Packet.h \
+    $$CLIPNET_ROOT/Payload.h \
+    $$CLIPNET_ROOT/Receiver.h \
+    $$CLIPNET_ROOT/Representation.h \
+    $$CLIPNET_ROOT/Sender.h \
+    $$CLIPNET_ROOT/Trace.h
@@ -0,0 +1,352 @@
+// End-to-end loopback benchmark.
+//
+// A single Sender multicasts clipboard events to N in-process peers, each
+// with its own Receiver and Secure instance, over the loopback interface.
+// Every message goes through the same payload code as MainWindow's
+// (Payload.h: representation choice, compression) and the same framing
+// (Packet.h: a single datagram, or fragments for a larger body).  The
+// receiving side decrypts and parses as MainWindow does, but reassembles
+// fragments without its caps and timeouts, and does not touch a clipboard.
+//
+// One JSON object is written to stdout per (family, payload size) pair.
+
+#include <QTimer>
+#include <QDateTime>
+#include <QEventLoop>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+
+#include <limits>
+#include <random>
+#include <vector>
+#include <unordered_map>
+
+#include "BenchSupport.h"
+
+#include "Packet.h"
+#include "Secure.h"
+#include "Payload.h"
+#include "Sender.h"
+#include "Receiver.h"
+
+namespace
+{
+    // the fragments of a body received so far
+    struct Reassembly
+    {
+        QByteArray body;
+        std::vector<bool> received;
+        uint32_t remaining{0};
+        Action action{Action::None};
+    };
+
+    struct Peer
+    {
+        Receiver* receiver{nullptr};
+        secure_ptr_t security;
+        std::unordered_map<uint32_t, Reassembly> reassembly;   // by message id
+    };
+
+    struct Run
+    {
+        QEventLoop* loop{nullptr};
+        uint32_t message_id{0};
+        int pending{0};
+        uint64_t sent_ns{0};
+        std::vector<double> latencies_us;
+    };
+
+    // roughly what people copy: prose with the occasional URL
+    QString make_text(qint64 size)
+    {
+        static const QString corpus{
+            "The quick brown fox jumps over the lazy dog. "
+            "See https://example.com/path?query=value&other=1 for details.\n"};
+
+        QString text;
+        text.reserve(static_cast<int>(size));
+        while (text.size() < size)
+            text.append(corpus);
+        text.truncate(static_cast<int>(size));
+        return text;
+    }
+
+    QByteArray make_payload(const QString& host, const QString& text, uint32_t message_id, Action& action)
+    {
+        QJsonObject json;
+        json["host"] = host;
+        json["sent"] = QDateTime::currentMSecsSinceEpoch();
+
+        return payload::build(json, text, QString(), 0, message_id, action);
+    }
+
+    /*!
+    Add a Fragment packet to the body it belongs to.
+
+    \param peer The receiving peer.
+    \param packet A verified packet whose action is Action::Fragment.
+    \param body Receives the body once its last fragment is in.
+    \param action Receives the Action of the completed body.
+    \returns A Boolean true if the body is complete.
+    */
+    bool reassemble(Peer& peer, const Packet* packet, QByteArray& body, Action& action)
+    {
+        constexpr int piece_size{max_datagram_payload - static_cast<int>(sizeof(Fragment))};
+
+        auto fragment{parse_fragment(packet)};
+        if (!fragment)
+            return false;
+
+        auto& reassembly{peer.reassembly[packet->message_id]};
+        if (reassembly.received.empty())
+        {
+            reassembly.body = QByteArray(static_cast<int>(fragment->body_size), Qt::Uninitialized);
+            reassembly.received.assign(fragment->count, false);
+            reassembly.remaining = fragment->count;
+            reassembly.action = static_cast<Action>(fragment->action);
+        }
+
+        auto offset{static_cast<int>(fragment->index) * piece_size};
+        auto size{packet->payload_size - static_cast<int>(sizeof(Fragment))};
+        if (fragment->count != reassembly.received.size() || offset + size > reassembly.body.size() || reassembly.received[fragment->index])
+            return false;
+
+        ::memcpy(reassembly.body.data() + offset, &packet->payload[sizeof(Fragment)], static_cast<size_t>(size));
+        reassembly.received[fragment->index] = true;
+        if (--reassembly.remaining)
+            return false;
+
+        body = reassembly.body;
+        action = reassembly.action;
+        peer.reassembly.erase(packet->message_id);
+        return true;
+    }
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("loopback");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("ClipNet end-to-end loopback benchmark");
+    parser.addHelpOption();
+    parser.addOption({"peers", "Number of in-process receiving peers.", "count", "3"});
+    parser.addOption({"family", "Address family to exercise: ipv4, ipv6 or both.", "family", "both"});
+    parser.addOption({"ipv4", "IPv4 multicast group.", "address", "239.255.43.21"});
+    parser.addOption({"ipv6", "IPv6 multicast group.", "address", "ff12::4321"});
+    parser.addOption({"port", "Multicast group port.", "port", "45455"});
+    parser.addOption({"iterations", "Messages per payload size (scaled down for large payloads).", "count", "500"});
+    parser.addOption({"max-size", "Largest payload size in bytes.", "bytes", "104857600"});
+    parser.addOption({"timeout", "Milliseconds to wait for a message to reach every peer.", "ms", "1000"});
+    parser.addOption({"passphrase", "Passphrase used to build the Secure instances.", "text", "benchmark"});
+    parser.addOption({"cipher", "Cipher the sender encrypts with (see crypto::name()), or auto.", "name", "auto"});
+    parser.addOption({"tag", "Free-form label (e.g., a commit hash) copied into every result.", "text", ""});
+    parser.process(app);
+
+    auto peer_count{qMax(1, parser.value("peers").toInt())};
+    auto port{static_cast<uint16_t>(parser.value("port").toUInt())};
+    auto iterations{qMax(1, parser.value("iterations").toInt())};
+    auto max_size{parser.value("max-size").toLongLong()};
+    auto timeout_ms{parser.value("timeout").toInt()};
+    auto passphrase{parser.value("passphrase")};
+    auto cipher_name{parser.value("cipher")};
+    auto tag{parser.value("tag")};
+
+    QStringList families;
+    auto family{parser.value("family").toLower()};
+    if (family == "ipv4" || family == "both")
+        families << "ipv4";
+    if (family == "ipv6" || family == "both")
+        families << "ipv6";
+
+    std::random_device rd;
+    std::mt19937 rd_mt(rd());
+    std::uniform_int_distribution<> sender_id(1, std::numeric_limits<int>::max());
+    auto sender{sender_id(rd_mt)};
+
+    // 10 B .. max_size, one decade per step with a midpoint
+    std::vector<qint64> sizes;
+    for (qint64 decade = 10; decade <= max_size; decade *= 10)
+    {
+        sizes.push_back(decade);
+        if (decade * 3 <= max_size)
+            sizes.push_back(decade * 3);
+    }
+
+    for (const auto& fam : families)
+    {
+        auto ipv4_group{fam == "ipv4" ? parser.value("ipv4") : QString()};
+        auto ipv6_group{fam == "ipv6" ? parser.value("ipv6") : QString()};
+
+        Run run;
+        uint32_t next_message_id{0};
+
+        std::vector<Peer> peers(static_cast<size_t>(peer_count));
+        for (auto& peer : peers)
+        {
+#if defined(USE_ENCRYPTION)
+            peer.security = Secure::create(passphrase);
+#endif
+            peer.receiver = new Receiver(port, ipv4_group, ipv6_group);
+            auto target{&peer};
+            QObject::connect(peer.receiver, &Receiver::signal_datagram_avaialble, [&run, target, sender](const QByteArray& datagram) {
+                const auto& security{target->security};
+
+                auto packet{parse_packet(datagram)};
+                if (!packet || packet->sender != sender || !verify_packet(packet, security))
+                    return;
+
+                // a header naming a cipher from a newer build (or a forged
+                // one) must not be cast to a Cipher
+                if (packet->cipher > crypto::max_cipher)
+                    return;
+
+                auto action{static_cast<Action>(packet->action)};
+                QByteArray buffer;
+                if (action == Action::Fragment)
+                {
+                    if (!reassemble(*target, packet, buffer, action))
+                        return;
+                }
+                else
+                    buffer = QByteArray(reinterpret_cast<const char*>(&packet->payload[0]), packet->payload_size);
+
+                if (action != Action::ClipData && action != Action::CompressedClipData)
+                    return;
+
+#if defined(USE_ENCRYPTION)
+                auto cipher{static_cast<crypto::Cipher>(packet->cipher)};
+                if (!security->supports(cipher))
+                    return;
+
+                bool success{false};
+                buffer = security->decrypt(buffer, cipher, success);
+                if (!success)
+                    return;
+#endif
+                // like MainWindow, a compressed copy's representations stay
+                // compressed until an application pastes them
+                auto parsed{payload::parse(buffer, action, packet->sender, packet->message_id)};
+                if (parsed.json.isNull())
+                    return;
+
+                if (packet->message_id != run.message_id)
+                    return;
+
+                run.latencies_us.push_back(static_cast<double>(bench::now_ns() - run.sent_ns) / 1000.0);
+                if (--run.pending == 0 && run.loop)
+                    run.loop->quit();
+            });
+        }
+
+        Sender multicast_sender(port, ipv4_group, ipv6_group);
+        secure_ptr_t security;
+#if defined(USE_ENCRYPTION)
+        security = Secure::create(passphrase, cipher_name);
+#endif
+
+        // let the group joins settle before measuring anything
+        {
+            QEventLoop settle;
+            QTimer::singleShot(250, &settle, &QEventLoop::quit);
+            settle.exec();
+        }
+
+        for (auto size : sizes)
+        {
+            auto text{make_text(size)};
+
+            // keep the total volume per step bounded for the large sizes
+            auto count{static_cast<int>(qBound<qint64>(1, (64LL * 1024 * 1024) / size, iterations))};
+
+            run.latencies_us.clear();
+            int delivered{0};
+            int dropped{0};
+            uint64_t allocations{0};
+            uint64_t wire_bytes{0};
+
+            auto start_ns{bench::now_ns()};
+
+            for (int i = 0; i < count; ++i)
+            {
+                QEventLoop loop;
+                QTimer deadline;
+                deadline.setSingleShot(true);
+                QObject::connect(&deadline, &QTimer::timeout, &loop, &QEventLoop::quit);
+
+                auto allocations_before{bench::allocation_count()};
+
+                run.message_id = ++next_message_id;
+                run.pending = peer_count;
+                run.sent_ns = bench::now_ns();
+
+                Action action{Action::ClipData};
+                auto payload{make_payload("loopback", text, run.message_id, action)};
+#if defined(USE_ENCRYPTION)
+                bool success{false};
+                payload = security->encrypt(payload, success);
+#endif
+                // framed as MainWindow::notify_clipboard_event() frames it
+                if (payload.size() <= max_datagram_payload)
+                {
+                    auto datagram{build_packet(sender, run.message_id, action, payload, security)};
+                    wire_bytes += static_cast<uint64_t>(datagram.size());
+                    multicast_sender.send_datagram(datagram);
+                }
+                else
+                {
+                    for (const auto& datagram : build_fragments(sender, run.message_id, action, payload, security))
+                    {
+                        wire_bytes += static_cast<uint64_t>(datagram.size());
+                        multicast_sender.send_datagram(datagram);
+                    }
+                }
+
+                // a peer may already have processed it synchronously
+                if (run.pending > 0)
+                {
+                    run.loop = &loop;
+                    deadline.start(timeout_ms);
+                    loop.exec();
+                    run.loop = nullptr;
+                }
+
+                allocations += bench::allocation_count() - allocations_before;
+
+                delivered += peer_count - qMax(0, run.pending);
+                dropped += qMax(0, run.pending);
+            }
+
+            auto elapsed_s{static_cast<double>(bench::now_ns() - start_ns) / 1e9};
+
+            QJsonObject result;
+            result["bench"] = "loopback";
+            result["tag"] = tag;
+            result["backend"] = security ? crypto::name(security->cipher()) : QString("none");
+            result["family"] = fam;
+            result["peers"] = peer_count;
+            result["payload_bytes"] = size;
+            result["messages"] = count;
+            result["deliveries"] = delivered;
+            result["drops"] = dropped;
+            result["p50_us"] = bench::percentile(run.latencies_us, 0.50);
+            result["p99_us"] = bench::percentile(run.latencies_us, 0.99);
+            result["p999_us"] = bench::percentile(run.latencies_us, 0.999);
+            result["throughput_MBps"] = elapsed_s > 0.0 ? (static_cast<double>(size) * delivered) / elapsed_s / 1e6 : 0.0;
+            result["wire_bytes_per_msg"] = static_cast<double>(wire_bytes) / count;
+            result["allocs_per_msg"] = static_cast<double>(allocations) / count;
+            bench::emit_result(result);
+        }
+
+        for (auto& peer : peers)
+        {
+            delete peer.receiver;
+            peer.reassembly.clear();
+        }
+    }
+
+    return 0;
+}
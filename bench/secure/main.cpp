@@ -0,0 +1,260 @@
+// Secure microbenchmark.
+//
+// Measures what every cryptographic backend the build includes costs,
+// separating the one-time key setup (Secure::create, and each cipher's
+// share of it) from the per-call overhead and the per-byte cost of
+// encrypt/decrypt.  Per-call and per-byte costs are found by a
+// least-squares fit of call time against payload size, so fixed work (the
+// obfuscation day-of-year key rebuild, an AEAD's nonce and tag, ...) shows
+// up in the intercept and bulk work in the slope.
+//
+// One JSON object is written to stdout per measurement.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QJsonObject>
+#include <QJsonDocument>
+
+#include <vector>
+
+#include "BenchSupport.h"
+
+#include "Secure.h"
+
+namespace
+{
+    struct Corpus
+    {
+        QString name;
+        QByteArray unit; // repeated to reach the requested size
+    };
+
+    // representative of what actually lands on a clipboard
+    std::vector<Corpus> make_corpora()
+    {
+        std::vector<Corpus> corpora;
+
+        corpora.push_back({"url", "https://docs.example.com/team/projects/clipnet/issues?state=open&sort=updated&page=2 "});
+        corpora.push_back(
+            {"prose",
+             "Do you use multiple machines during the day?  Are they all on the same LAN segment?  "
+             "Exchanging text information between them requires going out to the cloud to paste it.\n"});
+        corpora.push_back(
+            {"code",
+             "void MainWindow::slot_housekeeping()\n{\n    if (m_clear_clipboard_countdown != -1)\n    {\n"
+             "        if (--m_clear_clipboard_countdown == 0)\n            m_clipboard->setText(\"\");\n    }\n}\n"});
+        corpora.push_back(
+            {"unicode", QString::fromUtf8("Grüße aus Köln — 東京の天気は晴れです。 Привет, мир! 🙂📋 ").toUtf8()});
+        corpora.push_back(
+            {"html",
+             "<div class=\"post\"><p style=\"margin:0;font-family:Arial\">Paste from a <b>browser</b> "
+             "carries <a href=\"https://example.com/a/b?c=d\">markup</a> and inline styles.</p></div>\n"});
+
+        // the JSON envelope slot_read_clipboard() actually encrypts
+        QJsonObject json;
+        json["host"] = "workstation";
+        json["text"] = QString::fromUtf8(corpora[1].unit);
+        json["html"] = QString::fromUtf8(corpora[4].unit);
+        corpora.push_back({"json", QJsonDocument(json).toJson()});
+
+        return corpora;
+    }
+
+    QByteArray fill(const QByteArray& unit, int size)
+    {
+        QByteArray data;
+        data.reserve(size);
+        while (data.size() < size)
+            data.append(unit);
+        data.truncate(size);
+        return data;
+    }
+
+    struct Fit
+    {
+        double intercept{0.0};
+        double slope{0.0};
+    };
+
+    Fit least_squares(const std::vector<double>& x, const std::vector<double>& y)
+    {
+        Fit fit;
+        auto n{static_cast<double>(x.size())};
+        if (x.size() < 2)
+            return fit;
+
+        double sx{0.0}, sy{0.0}, sxx{0.0}, sxy{0.0};
+        for (size_t i = 0; i < x.size(); ++i)
+        {
+            sx += x[i];
+            sy += y[i];
+            sxx += x[i] * x[i];
+            sxy += x[i] * y[i];
+        }
+
+        auto denominator{n * sxx - sx * sx};
+        if (denominator == 0.0)
+            return fit;
+
+        fit.slope = (n * sxy - sx * sy) / denominator;
+        fit.intercept = (sy - fit.slope * sx) / n;
+        return fit;
+    }
+
+    // median of 'repeats' timed batches, in counter units per call
+    template <typename F>
+    double measure(F&& operation, int calls, int repeats)
+    {
+        std::vector<double> samples;
+        for (int r = 0; r < repeats; ++r)
+        {
+            auto start{bench::cycles()};
+            for (int i = 0; i < calls; ++i)
+                operation();
+            samples.push_back(static_cast<double>(bench::cycles() - start) / calls);
+        }
+        return bench::percentile(samples, 0.5);
+    }
+
+    QJsonObject result_base(const QString& tag, crypto::Cipher cipher)
+    {
+        QJsonObject result;
+        result["bench"] = "secure";
+        result["tag"] = tag;
+        result["backend"] = crypto::name(cipher);
+        result["aes_hardware"] = crypto::has_aes_hardware();
+        result["unit"] = bench::have_cycle_counter() ? "cycles" : "ns";
+        return result;
+    }
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("secure");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("ClipNet Secure microbenchmark");
+    parser.addHelpOption();
+    parser.addOption({"passphrase", "Passphrase handed to Secure::create.", "text", "correct horse battery staple"});
+    parser.addOption({"repeats", "Timed batches per measurement (the median is reported).", "count", "15"});
+    parser.addOption({"tag", "Free-form label (e.g., a commit hash) copied into every result.", "text", ""});
+    parser.process(app);
+
+    auto passphrase{parser.value("passphrase")};
+    auto repeats{qMax(3, parser.value("repeats").toInt())};
+    auto tag{parser.value("tag")};
+
+#if !defined(USE_ENCRYPTION)
+    Q_UNUSED(passphrase)
+    Q_UNUSED(repeats)
+    auto result{result_base(tag, crypto::Cipher::none)};
+    result["error"] = "no encryption backend configured";
+    bench::emit_result(result);
+    return 1;
+#else
+    // key setup for every cipher the build includes, as a join does it
+    {
+        auto allocations_before{bench::allocation_count()};
+        auto per_call{measure([&passphrase]() { (void)Secure::create(passphrase); }, 200, repeats)};
+
+        auto result{result_base(tag, crypto::fastest())};
+        result["op"] = "create";
+        result["per_call"] = per_call;
+        result["allocs_per_call"] = static_cast<double>(bench::allocation_count() - allocations_before) / (200.0 * repeats);
+        bench::emit_result(result);
+    }
+
+#if defined(SIMPLECRYPT)
+    // the fixed work SimpleCrypt hides inside encrypt/decrypt
+    for (auto size : {64, 4096, 65536})
+    {
+        auto data{QByteArray(size, 'x')};
+
+        auto result{result_base(tag, crypto::Cipher::simplecrypt)};
+        result["op"] = "base64_round_trip";
+        result["bytes"] = size;
+        result["per_call"] = measure([&data]() { (void)QByteArray::fromBase64(data.toBase64()); }, 200, repeats);
+        bench::emit_result(result);
+    }
+#endif
+
+    const std::vector<int> sizes{16, 256, 4096, 65536, 1048576};
+
+    const auto corpora{make_corpora()};
+
+    for (auto cipher : crypto::available())
+    {
+        // one cipher's key setup, on its own
+        {
+            auto backend{crypto::make_backend(cipher)};
+            auto key_material{passphrase.toUtf8()};
+
+            auto result{result_base(tag, cipher)};
+            result["op"] = "set_key";
+            result["per_call"] = measure([&]() { backend->set_key(key_material); }, 200, repeats);
+            bench::emit_result(result);
+        }
+
+        auto security{Secure::create(passphrase, crypto::name(cipher))};
+
+        for (const auto& corpus : corpora)
+        {
+            std::vector<double> x, encrypt_y, decrypt_y;
+            uint64_t encrypt_allocations{0}, decrypt_allocations{0};
+            int encrypt_calls{0}, decrypt_calls{0};
+
+            for (auto size : sizes)
+            {
+                auto plain{fill(corpus.unit, size)};
+                bool success{false};
+                auto encrypted{security->encrypt(plain, success)};
+
+                // keep each batch around a few megabytes
+                auto calls{qMax(1, (4 * 1024 * 1024) / size)};
+
+                auto allocations_before{bench::allocation_count()};
+                encrypt_y.push_back(measure([&]() { (void)security->encrypt(plain, success); }, calls, repeats));
+                encrypt_allocations += bench::allocation_count() - allocations_before;
+                encrypt_calls += calls * repeats;
+
+                allocations_before = bench::allocation_count();
+                decrypt_y.push_back(measure([&]() { (void)security->decrypt(encrypted, success); }, calls, repeats));
+                decrypt_allocations += bench::allocation_count() - allocations_before;
+                decrypt_calls += calls * repeats;
+
+                x.push_back(static_cast<double>(size));
+
+                for (const auto& op : {QStringLiteral("encrypt"), QStringLiteral("decrypt")})
+                {
+                    auto result{result_base(tag, cipher)};
+                    result["op"] = op;
+                    result["corpus"] = corpus.name;
+                    result["bytes"] = size;
+                    result["per_call"] = op == "encrypt" ? encrypt_y.back() : decrypt_y.back();
+                    result["expansion"] = static_cast<double>(encrypted.size()) / size;
+                    bench::emit_result(result);
+                }
+            }
+
+            auto encrypt_fit{least_squares(x, encrypt_y)};
+            auto decrypt_fit{least_squares(x, decrypt_y)};
+
+            auto summarize = [&](const QString& op, const Fit& fit, uint64_t allocations, int calls) {
+                auto result{result_base(tag, cipher)};
+                result["op"] = op;
+                result["corpus"] = corpus.name;
+                result["fixed_per_call"] = fit.intercept;
+                result["per_byte"] = fit.slope;
+                result["allocs_per_call"] = static_cast<double>(allocations) / calls;
+                bench::emit_result(result);
+            };
+
+            summarize("encrypt_fit", encrypt_fit, encrypt_allocations, encrypt_calls);
+            summarize("decrypt_fit", decrypt_fit, decrypt_allocations, decrypt_calls);
+        }
+    }
+
+    return 0;
+#endif
+}
@@ -0,0 +1,8 @@
+# Per-byte and per-call cost of Secure::create/encrypt/decrypt.
+
+TARGET = secure
+
+include(../common/common.pri)
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,71 @@
+# Cryptographic backend selection shared by the application and
+# the benchmark harnesses.  Choose your poison in the including
+# project (any of CONFIG += cryptopp simplecrypt obfuscate) before
+# including this file; every backend chosen is built in, and the
+# one used for sending is picked at runtime (see CryptoBackend.h).
+
+CLIPNET_ROOT = $$PWD
+
+cryptopp {
+    CRYPTOPP_PREFIX = $$(CRYPTOPP_INSTALL_ROOT)
+    isEmpty(CRYPTOPP_PREFIX){
+        win32 {
+            CRYPTOPP_PREFIX = M:\Projects\cryptopp
+        }
+        unix:!mac {
+            CRYPTOPP_PREFIX = /home/bob/projects/cryptopp/x86_64
+        }
+    }
+
+    # from a security standpoint, Crypt++ is preferrable to
+    # SimpleCrypt (as SimpleCrypt is preferrable to nothing
+    # at all)...  Crypto++ 8.1 or later is needed for
+    # ChaCha20-Poly1305.
+
+    DEFINES += USE_ENCRYPTION
+    DEFINES += CRYPTOPP
+
+    INCLUDEPATH += $$CRYPTOPP_PREFIX
+
+    win32 {
+        LIBS += -lcryptlib
+        CONFIG(debug, debug|release) {
+            LIBS += -L$$CRYPTOPP_PREFIX\x64\Output\Debug
+        } else {
+            LIBS += -L$$CRYPTOPP_PREFIX\x64\Output\Release
+        }
+    }
+    unix:!mac {
+        # https://stackoverflow.com/questions/6578484/telling-gcc-directly-to-link-a-library-statically
+        LIBS += -l:libcryptopp.a
+        LIBS += -L$$CRYPTOPP_PREFIX
+    }
+}
+
+simplecrypt {
+    # ...however, if you're exchanging clipbaord data
+    # between machines on an isolated network, or you
+    # aren't paranoid enough to use a heavier crypto
+    # solution like AES, then SimpleCrypt's obfuscation
+    # would likely be just fine for you.  This is only
+    # useful for desktop systems (see 'obfuscate' below).
+
+    DEFINES += USE_ENCRYPTION
+    DEFINES += SIMPLECRYPT
+
+    SOURCES += $$CLIPNET_ROOT/SimpleCrypt.cpp
+    HEADERS += $$CLIPNET_ROOT/SimpleCrypt.h
+}
+
+obfuscate {
+    # I could not get industrial strength crypto to
+    # function properly across platforms (PC <-> Mobile)
+    # because I just don't fully understand the
+    # nuances, and SimpleCrypt is only useful between
+    # Qt-based systems, so I fell back to using a
+    # home-grown obfuscation algorithm that functions
+    # correctly on all platforms and languages
+
+    DEFINES += USE_ENCRYPTION
+    DEFINES += OBFUSCATION
+}
@@ -1,5 +1,8 @@
 #include <random>
 #include <limits>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
 #include <functional>
 
 #ifdef QT_WIN
@@ -17,22 +20,111 @@
 #include <QDateTime>
 #include <QMimeData>
 #include <QSettings>
-#include <QDataStream>
+#include <QFile>
+#include <QScrollBar>
+#include <QFileDialog>
 #include <QMessageBox>
 #include <QStandardPaths>
 #include <QNetworkDatagram>
 #include <QNetworkInterface>
 
+#include <QJsonArray>
+#include <QElapsedTimer>
 #include <QJsonDocument>
-
+#include <QtConcurrent/QtConcurrentRun>
+
+#include "Trace.h"
+#include "Probes.h"
+#include "Metrics.h"
+#include "Payload.h"
+#include "KeyStore.h"
+#include "ClipMimeData.h"
+#include "ClipboardPoller.h"
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 
 static const QString& settings_version = "1.0";
 
-MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent), m_ui(new Ui::MainWindow)
+// the name the history's key is kept under in the system keystore
+static const QString history_key_name = "history_key";
+
+// how many of the most recent history entries the tray menu offers
+static const int history_menu_entries = 20;
+
+// how many entries the History page lists at most
+static const int history_search_results = 200;
+
+// a burst of incoming copies inside this window changes the local
+// clipboard once, to the newest of them
+static const int apply_window_ms = 150;
+
+// copies at least this many characters long are announced by a preview
+// before they are prepared and sent
+static const int progressive_threshold = 256 * 1024;
+
+// characters of text a preview carries
+static const int preview_length = 200;
+
+// how long the fragments of a body may take to arrive; also how long a
+// preview is held waiting for its body
+static const int reassembly_timeout_ms = 15000;
+
+// the largest body reassembled from fragments
+static const int max_body_size = 64 * 1024 * 1024;
+
+// how many bodies may be reassembled at once, and how many bytes they may
+// hold between them; fragments starting another are ignored
+static const int max_reassemblies = 8;
+static const qint64 max_reassembly_bytes = 128 * 1024 * 1024;
+
+// how long a staged passphrase waits for a peer to start using it before
+// we switch to it anyway
+static const int key_promotion_ms = 60000;
+
+// how long the previous passphrase is still accepted after a switch, for
+// members that have yet to follow and copies already in flight
+static const int key_retirement_ms = 120000;
+
+static QJsonObject stamp_json(const hlc::Timestamp& stamp)
 {
-    m_ui->setupUi(this);
+    QJsonObject json;
+    json["wall"] = static_cast<qint64>(stamp.wall);
+    json["count"] = static_cast<qint64>(stamp.count);
+    return json;
+}
+
+// used for the group settings left empty; the window shows them as placeholders
+static const QString default_group_port{"45454"};
+static const QString default_ipv4_group{"239.255.43.21"};
+static const QString default_ipv6_group{"ff12::2115"};
+
+static flight::Record flight_record(flight::Direction direction, int peer, uint32_t message_id)
+{
+    flight::Record record{};
+    record.timestamp_ms = QDateTime::currentMSecsSinceEpoch();
+    record.direction = direction;
+    record.peer = peer;
+    record.message_id = message_id;
+    return record;
+}
+
+// microseconds since the previous lap, for the flight record stage timings
+static uint32_t lap_us(const QElapsedTimer& timer, qint64& mark)
+{
+    auto now{timer.nsecsElapsed()};
+    auto elapsed{static_cast<uint32_t>(qMin<qint64>((now - mark) / 1000, 0xffffffff))};
+    mark = now;
+    return elapsed;
+}
+
+MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent)
+{
+    // the widget tree is not built until the window is first shown (see
+    // ensure_ui()); when ClipNet starts in the tray and rejoins its group,
+    // it may never be, and syncing does not wait for it
+
+    m_log_model = new LogModel(5000, this);
+    m_log_model->set_live(false);
 
     setWindowTitle(tr("ClipNet  by Bob Hood"));
     setWindowIcon(QIcon(":/images/ClipNet.png"));
@@ -42,6 +134,7 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent), m_ui(new Ui::Main
     std::mt19937 rd_mt(rd());
     std::uniform_int_distribution<> sender_id(1, std::numeric_limits<int>::max());
     m_sender_id = sender_id(rd_mt);
+    m_clock.set_node(m_sender_id);
 
 #ifdef QT_WIN
     TCHAR buffer[MAX_COMPUTERNAME_LENGTH + 1];
@@ -57,14 +150,107 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent), m_ui(new Ui::Main
     m_host_name = QString::fromLatin1(host.data());
 #endif
 
-    m_housekeeping_timer.setInterval(1000);
-    m_housekeeping_timer.callOnTimeout(this, &MainWindow::slot_housekeeping);
+    m_history = new History(this);
+    connect(m_history, &History::signal_loaded, this, &MainWindow::slot_search_history);
+    connect(m_history, &History::signal_searched, this, &MainWindow::slot_history_searched);
+
+    m_clipboard = QGuiApplication::clipboard();
+
+#if defined(QT_LINUX) || defined(QT_WIN)
+    // notifications are not to be relied on here
+    m_poller = new ClipboardPoller(m_clipboard, &m_wheel, this);
+    connect(m_poller, &ClipboardPoller::signal_changed, this, &MainWindow::slot_clipboard_polled);
+#endif
+
+    QDir::setCurrent(qApp->applicationDirPath());
 
     load_settings();
 
+    if (m_settings.autorejoin)
+        QTimer::singleShot(0, this, &MainWindow::slot_multicast_group_join);
+
+    m_stats_server = new StatsServer(std::bind(&MainWindow::statistics_snapshot, this), this);
+    m_stats_server->listen();
+
+    m_restore_action = new QAction(QIcon(":/images/Restore.png"), tr("&Restore"), this);
+    connect(m_restore_action, &QAction::triggered, this, &MainWindow::showNormal);
+
+    m_quit_action = new QAction(QIcon(":/images/Quit.png"), tr("&Quit"), this);
+    connect(m_quit_action, &QAction::triggered, this, &MainWindow::slot_quit);
+
+    m_history_search_action = new QAction(tr("&Search..."), this);
+    connect(m_history_search_action, &QAction::triggered, this, [this]() {
+        showNormal();
+        m_ui->toolBox->setCurrentWidget(m_ui->page_History);
+        m_ui->line_HistorySearch->setFocus();
+        m_ui->line_HistorySearch->selectAll();
+    });
+
+    m_tracing_action = new QAction(tr("&Tracing"), this);
+    m_tracing_action->setCheckable(true);
+    m_tracing_action->setChecked(Trace::enabled());
+    connect(m_tracing_action, &QAction::toggled, this, [](bool checked) { Trace::set_enabled(checked); });
+
+    m_export_trace_action = new QAction(tr("&Export trace..."), this);
+    connect(m_export_trace_action, &QAction::triggered, this, &MainWindow::slot_export_trace);
+
+    m_trayIcon = new QSystemTrayIcon(this);
+    connect(m_trayIcon, &QSystemTrayIcon::messageClicked, this, &MainWindow::slot_tray_message_clicked);
+    connect(m_trayIcon, &QSystemTrayIcon::activated, this, &MainWindow::slot_tray_icon_activated);
+
+    m_trayIcon->setIcon(QIcon(":/images/ClipNet.png"));
+    m_trayIcon->setToolTip(tr("ClipNet"));
+    build_tray_menu();
+
+    m_trayIcon->show();
+
+    if (!m_settings.autorejoin)
+        // open the main window to remind them that they need
+        // to initiate the connection manually
+        showNormal();
+}
+
+void MainWindow::ensure_ui()
+{
+    if (m_ui)
+        return;
+
+    m_ui = new Ui::MainWindow;
+    m_ui->setupUi(this);
+
     QFont f(font());
     f.setFamily("Consolas");
-    m_ui->edit_Log->setFont(f);
+    m_ui->list_Log->setFont(f);
+    m_ui->edit_Statistics->setFont(f);
+
+    m_ui->list_Log->setModel(m_log_model);
+    connect(m_log_model, &LogModel::rowsInserted, this, &MainWindow::slot_log_rows_inserted);
+
+    for (auto severity : {LogModel::Severity::Debug, LogModel::Severity::Info, LogModel::Severity::Warning, LogModel::Severity::Error})
+        m_ui->combo_LogSeverity->addItem(LogModel::name(severity), static_cast<int>(severity));
+    m_ui->combo_LogSeverity->setCurrentIndex(m_ui->combo_LogSeverity->findData(static_cast<int>(m_log_model->minimum_severity())));
+    connect(m_ui->combo_LogSeverity, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this](int index) {
+        m_log_model->set_minimum_severity(static_cast<LogModel::Severity>(m_ui->combo_LogSeverity->itemData(index).toInt()));
+    });
+
+    connect(m_ui->toolBox, &QToolBox::currentChanged, this, &MainWindow::slot_refresh_statistics);
+
+    if (m_stats_server->is_listening())
+        m_ui->label_StatisticsSocket->setText(tr("Statistics are also served as JSON on %1").arg(m_stats_server->server_path()));
+    else
+        m_ui->label_StatisticsSocket->setText(tr("Statistics socket unavailable: %1").arg(m_stats_server->error_string()));
+
+    settings_to_ui();
+
+    m_ui->button_Channels_Join->setText(m_multicast_group_member ? tr("Leave") : tr("Join"));
+
+    // from here on, the widgets are where the settings are edited
+    for (auto check_box : {m_ui->check_AutoStart, m_ui->check_AudioCue, m_ui->check_VisualCue, m_ui->check_Channels_IPv4,
+                           m_ui->check_Channels_IPv6, m_ui->check_Channels_AutoRejoin, m_ui->check_Encryption, m_ui->check_ClearClipboard})
+        connect(check_box, &QCheckBox::toggled, this, &MainWindow::slot_store_ui_settings);
+    for (auto line_edit : {m_ui->line_MulticastGroupPort, m_ui->line_MulticastGroupIPv4, m_ui->line_MulticastGroupIPv6,
+                           m_ui->line_Passphrase, m_ui->line_ClearClipboardSeconds})
+        connect(line_edit, &QLineEdit::textChanged, this, &MainWindow::slot_store_ui_settings);
 
 #ifdef QT_WIN
     connect(m_ui->check_AutoStart, &QCheckBox::clicked, this, &MainWindow::slot_set_startup);
@@ -74,6 +260,10 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent), m_ui(new Ui::Main
 #endif
 
     connect(m_ui->check_AudioCue, &QCheckBox::clicked, this, &MainWindow::slot_set_control_states);
+    connect(m_ui->check_AudioCue, &QCheckBox::toggled, this, [this](bool checked) {
+        if (m_cue || checked)
+            cue()->slot_set_audio_enabled(checked);
+    });
     connect(m_ui->check_VisualCue, &QCheckBox::clicked, this, &MainWindow::slot_set_control_states);
 
     connect(m_ui->check_Channels_IPv4, &QCheckBox::clicked, this, &MainWindow::slot_set_control_states);
@@ -81,369 +271,1493 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent), m_ui(new Ui::Main
     connect(m_ui->check_Channels_IPv6, &QCheckBox::clicked, this, &MainWindow::slot_set_control_states);
     connect(m_ui->button_MulticastGroupIPv6_Randomize, &QPushButton::clicked, this, &MainWindow::slot_randomize_ipv6);
 
-    connect(m_ui->button_Channels_Join, &QPushButton::clicked, this, &MainWindow::slot_multicast_group_join);
-    connect(m_ui->check_Channels_AutoRejoin, &QCheckBox::clicked, this, &MainWindow::slot_set_control_states);
+    connect(m_ui->button_Channels_Join, &QPushButton::clicked, this, &MainWindow::slot_multicast_group_join);
+    connect(m_ui->check_Channels_AutoRejoin, &QCheckBox::clicked, this, &MainWindow::slot_set_control_states);
+
+#if defined(USE_ENCRYPTION)
+    connect(m_ui->check_Encryption, &QCheckBox::clicked, this, &MainWindow::slot_set_control_states);
+    connect(m_ui->line_Passphrase, &QLineEdit::editingFinished, this, &MainWindow::slot_stage_passphrase);
+#else
+    m_ui->check_Encryption->setVisible(false);
+    m_ui->line_Passphrase->setVisible(false);
+#endif
+
+    connect(m_ui->check_ClearClipboard, &QCheckBox::clicked, this, &MainWindow::slot_clear_clipboard);
+
+    connect(m_ui->line_HistorySearch, &QLineEdit::textChanged, this, &MainWindow::slot_search_history);
+    connect(m_ui->list_History, &QListWidget::itemActivated, this, &MainWindow::slot_recall_history_item);
+
+    slot_set_control_states();
+}
+
+Cue* MainWindow::cue()
+{
+    if (!m_cue)
+        m_cue = CuePointer(new Cue(&m_wheel));
+    return m_cue.data();
+}
+
+void MainWindow::build_tray_menu()
+{
+    if (m_trayIconMenu)
+    {
+        disconnect(m_trayIconMenu, &QMenu::triggered, this, &MainWindow::slot_tray_menu_action);
+        delete m_trayIconMenu;
+    }
+
+    m_trayIconMenu = new QMenu(this);
+
+    //trayIconMenu->addSeparator();
+
+    m_trayIconMenu->addAction(m_restore_action);
+    m_trayIconMenu->addSeparator();
+
+    // filled in each time it is opened, so it is always current and costs
+    // nothing while it is closed
+    m_history_menu = m_trayIconMenu->addMenu(tr("&History"));
+    connect(m_history_menu, &QMenu::aboutToShow, this, &MainWindow::slot_populate_history_menu);
+    connect(m_history_menu, &QMenu::triggered, this, &MainWindow::slot_recall_history);
+
+    m_trayIconMenu->addSeparator();
+    m_trayIconMenu->addAction(m_tracing_action);
+    m_trayIconMenu->addAction(m_export_trace_action);
+    m_trayIconMenu->addSeparator();
+    m_trayIconMenu->addAction(m_quit_action);
+
+    m_trayIcon->setContextMenu(m_trayIconMenu);
+
+    connect(m_trayIconMenu, &QMenu::triggered, this, &MainWindow::slot_tray_menu_action);
+}
+
+void MainWindow::setVisible(bool visible)
+{
+    //restoreAction->setEnabled(isMaximized() || !visible);
+
+    if (visible)
+        ensure_ui();
+
+    // the log only does view work while there is a view to update
+    if (visible)
+        m_log_model->set_live(true);
+
+    QWidget::setVisible(visible);
+
+    if (visible)
+        m_ui->list_Log->scrollToBottom();
+    else
+        m_log_model->set_live(false);
+
+    if (visible)
+    {
+        QTimer::singleShot(0, this, &MainWindow::slot_refresh_statistics);
+        QTimer::singleShot(0, this, &MainWindow::slot_search_history);
+    }
+}
+
+void MainWindow::closeEvent(QCloseEvent* event)
+{
+    if (m_trayIcon->isVisible())
+    {
+        //QMessageBox::information(this,
+        //                         tr("Tray"),
+        //                         tr("The program will keep running in the "
+        //                            "system tray. To terminate the program, "
+        //                            "choose <b>Quit</b> in the context menu "
+        //                            "of the system tray entry."));
+        hide();
+        event->ignore();
+    }
+}
+
+void MainWindow::load_settings()
+{
+    m_multicast_group_member = false;
+
+    QString settings_file_name;
+#ifdef QT_WIN
+    settings_file_name = QDir::toNativeSeparators(QString("%1/ClipNet/Settings.ini").arg(qgetenv("APPDATA").constData()));
+#endif
+#ifdef QT_LINUX
+    settings_file_name = QDir::toNativeSeparators(QString("%1/ClipNet.ini").arg(QStandardPaths::standardLocations(QStandardPaths::ConfigLocation)[0]));
+#endif
+    QSettings settings(settings_file_name, QSettings::IniFormat);
+
+    m_settings.startup_enabled = settings.value("startup_enabled", false).toBool();
+
+    m_settings.audio_cue = settings.value("audio_cue", false).toBool();
+    m_settings.visual_cue = settings.value("visual_cue", false).toBool();
+
+    m_settings.group_port = settings.value("group_port", "").toString();
+
+    //    m_protocol = static_cast<Protocol>(settings.value("protocol", 0).toInt());
+
+    m_settings.ipv4_enabled = settings.value("ipv4_multicast_group_enabled", false).toBool();
+    m_settings.ipv4_address = settings.value("ipv4_multicast_group_address", "").toString();
+
+    m_settings.ipv6_enabled = settings.value("ipv6_multicast_group_enabled", false).toBool();
+    m_settings.ipv6_address = settings.value("ipv6_multicast_group_address", "").toString();
+
+    m_settings.autorejoin = settings.value("channels_autorejoin", false).toBool();
+
+#ifdef USE_ENCRYPTION
+    m_settings.use_encryption = settings.value("use_encryption", false).toBool();
+    m_settings.passphrase = settings.value("passphrase", "").toString();
+    m_settings.cipher = settings.value("cipher", "auto").toString();
+    m_settings.minimum_cipher = settings.value("minimum_cipher", "none").toString();
+#endif
+
+    m_settings.clear_clipboard = settings.value("clear_clipboard", false).toBool();
+    m_settings.clear_clipboard_seconds = settings.value("clear_clipboard_seconds", "").toString();
+
+    Trace::set_enabled(settings.value("tracing", false).toBool());
+
+    m_clipboard_polling = settings.value("clipboard_polling", true).toBool();
+
+    // older builds kept the history's key here; it stays only until it
+    // has been moved to the system keystore
+    m_legacy_history_key = settings.value("history_key", "").toString();
+
+    m_settings.history = settings.value("history", false).toBool();
+    m_settings.history_capacity = settings.value("history_capacity", 1000).toInt();
+    if (m_settings.history)
+        open_history();
+
+    if (settings.value("flight_recorder", true).toBool())
+    {
+        auto flight_file{FlightRecorder::default_file_name()};
+        if (!FlightRecorder::instance().open(flight_file))
+            log(LogModel::Severity::Warning, tr("Could not open the flight recorder file %1").arg(QDir::toNativeSeparators(flight_file)));
+    }
+}
+
+void MainWindow::save_settings()
+{
+    QString settings_file_name;
+#ifdef QT_WIN
+    settings_file_name = QDir::toNativeSeparators(QString("%1/ClipNet/Settings.ini").arg(qgetenv("APPDATA").constData()));
+#endif
+#ifdef QT_LINUX
+    settings_file_name = QDir::toNativeSeparators(QString("%1/ClipNet.ini").arg(QStandardPaths::standardLocations(QStandardPaths::ConfigLocation)[0]));
+#endif
+    QSettings settings(settings_file_name, QSettings::IniFormat);
+
+    settings.clear();
+
+    settings.setValue("startup_enabled", m_settings.startup_enabled);
+
+    settings.setValue("audio_cue", m_settings.audio_cue);
+    settings.setValue("visual_cue", m_settings.visual_cue);
+
+    settings.setValue("group_port", m_settings.group_port);
+
+    settings.setValue("ipv4_multicast_group_enabled", m_settings.ipv4_enabled);
+    settings.setValue("ipv4_multicast_group_address", m_settings.ipv4_address);
+
+    settings.setValue("ipv6_multicast_group_enabled", m_settings.ipv6_enabled);
+    settings.setValue("ipv6_multicast_group_address", m_settings.ipv6_address);
+
+    settings.setValue("channels_autorejoin", m_settings.autorejoin);
+
+#if defined(USE_ENCRYPTION)
+    settings.setValue("use_encryption", m_settings.use_encryption);
+    settings.setValue("passphrase", m_settings.passphrase);
+    settings.setValue("cipher", m_settings.cipher);
+    settings.setValue("minimum_cipher", m_settings.minimum_cipher);
+#endif
+
+    settings.setValue("clear_clipboard", m_settings.clear_clipboard);
+    settings.setValue("clear_clipboard_seconds", m_settings.clear_clipboard_seconds);
+
+    settings.setValue("tracing", Trace::enabled());
+    settings.setValue("clipboard_polling", m_clipboard_polling);
+    settings.setValue("flight_recorder", FlightRecorder::instance().is_open());
+
+    // a keystore that could not be read this session is no reason to
+    // turn the history off for good
+    settings.setValue("history", m_settings.history);
+    settings.setValue("history_capacity", m_settings.history_capacity);
+    if (!m_legacy_history_key.isEmpty())
+        settings.setValue("history_key", m_legacy_history_key);
+}
+
+void MainWindow::open_history()
+{
+#if defined(USE_ENCRYPTION)
+    if (crypto::stored() == crypto::Cipher::none)
+    {
+        log(LogModel::Severity::Warning, tr("The clipboard history is off: this build has no cipher to keep it with"));
+        return;
+    }
+
+    // the keystore may take a while to answer (or time out), which
+    // startup does not wait for; the history opens once it has
+    auto watcher{new history_key_watcher_t(this)};
+    connect(watcher, &history_key_watcher_t::finished, this, [this, watcher]() {
+        watcher->deleteLater();
+        history_key_fetched(watcher->result());
+    });
+
+    watcher->setFuture(QtConcurrent::run(&MainWindow::fetch_history_key, m_legacy_history_key.toLatin1()));
+#else
+    open_history_store(QString());
+#endif
+}
+
+MainWindow::HistoryKey MainWindow::fetch_history_key(QByteArray legacy_key)
+{
+    // a key kept in the settings file, next to the store it protects,
+    // would protect nothing; without a keystore, there is no history
+    HistoryKey fetched;
+    fetched.result = keystore::read(history_key_name, fetched.key);
+
+    // a new key orphans every entry sealed with the old one, so one is
+    // only made when the keystore says it has none
+    if (fetched.result != keystore::Result::missing)
+        return fetched;
+
+    fetched.key = legacy_key;
+    if (fetched.key.isEmpty())
+    {
+        // private to this installation; the history never leaves the machine
+        std::random_device rd;
+        QByteArray random(32, 0);
+        for (auto& byte : random)
+            byte = static_cast<char>(rd() & 0xff);
+        fetched.key = random.toHex();
+    }
+
+    fetched.created = true;
+    fetched.result = keystore::write(history_key_name, fetched.key) ? keystore::Result::found : keystore::Result::failed;
+    return fetched;
+}
+
+void MainWindow::history_key_fetched(const HistoryKey& fetched)
+{
+    if (fetched.result != keystore::Result::found)
+    {
+        // the stored key (and any legacy one) is kept for a later session
+        if (fetched.created)
+            log(LogModel::Severity::Warning, tr("The clipboard history is off: there is no system keystore to keep its key in"));
+        else
+            log(LogModel::Severity::Warning, tr("The clipboard history is off for this session: the system keystore could not be read"));
+        return;
+    }
+
+    open_history_store(QString::fromLatin1(fetched.key));
+}
+
+void MainWindow::open_history_store(const QString& key)
+{
+    m_legacy_history_key.clear();
+
+    auto history_file{History::default_file_name()};
+    if (!m_history->open(history_file, m_settings.history_capacity, key))
+        log(LogModel::Severity::Warning, tr("Could not open the clipboard history %1").arg(QDir::toNativeSeparators(history_file)));
+}
+
+void MainWindow::settings_to_ui()
+{
+    m_ui->check_AutoStart->setChecked(m_settings.startup_enabled);
+
+    m_ui->check_AudioCue->setChecked(m_settings.audio_cue);
+    m_ui->check_VisualCue->setChecked(m_settings.visual_cue);
+
+    m_ui->line_MulticastGroupPort->setText(m_settings.group_port);
+
+    m_ui->check_Channels_IPv4->setChecked(m_settings.ipv4_enabled);
+    m_ui->line_MulticastGroupIPv4->setText(m_settings.ipv4_address);
+
+    m_ui->check_Channels_IPv6->setChecked(m_settings.ipv6_enabled);
+    m_ui->line_MulticastGroupIPv6->setText(m_settings.ipv6_address);
+
+    m_ui->check_Channels_AutoRejoin->setChecked(m_settings.autorejoin);
+
+    m_ui->check_Encryption->setChecked(m_settings.use_encryption);
+    m_ui->line_Passphrase->setText(m_settings.passphrase);
+
+    m_ui->check_ClearClipboard->setChecked(m_settings.clear_clipboard);
+    m_ui->line_ClearClipboardSeconds->setText(m_settings.clear_clipboard_seconds);
+}
+
+void MainWindow::slot_store_ui_settings()
+{
+    m_settings.startup_enabled = m_ui->check_AutoStart->isChecked();
+
+    m_settings.audio_cue = m_ui->check_AudioCue->isChecked();
+    m_settings.visual_cue = m_ui->check_VisualCue->isChecked();
+
+    m_settings.group_port = m_ui->line_MulticastGroupPort->text();
+
+    m_settings.ipv4_enabled = m_ui->check_Channels_IPv4->isChecked();
+    m_settings.ipv4_address = m_ui->line_MulticastGroupIPv4->text();
+
+    m_settings.ipv6_enabled = m_ui->check_Channels_IPv6->isChecked();
+    m_settings.ipv6_address = m_ui->line_MulticastGroupIPv6->text();
+
+    m_settings.autorejoin = m_ui->check_Channels_AutoRejoin->isChecked();
+
+    m_settings.use_encryption = m_ui->check_Encryption->isChecked();
+    m_settings.passphrase = m_ui->line_Passphrase->text();
+
+    m_settings.clear_clipboard = m_ui->check_ClearClipboard->isChecked();
+    m_settings.clear_clipboard_seconds = m_ui->line_ClearClipboardSeconds->text();
+}
+
+void MainWindow::notify_clipboard_event(const QByteArray& payload, uint32_t message_id, Action action, const secure_ptr_t& security, flight::Record& record, const QString& display)
+{
+    auto& metrics{Metrics::instance()};
+
+    metrics.record(Metrics::Histogram::PayloadBytes, static_cast<uint64_t>(payload.size()));
+
+    QElapsedTimer send_timer;
+    send_timer.start();
+
+    bool sent{true};
+    int datagram_bytes{0};
+    {
+        TraceScope scope(Trace::Stage::Send, m_sender_id, message_id);
+
+        if (payload.size() <= max_datagram_payload)
+        {
+            auto datagram{build_packet(m_sender_id, message_id, action, payload, security)};
+            sent = m_multicast_sender->send_datagram(datagram);
+            datagram_bytes = datagram.size();
+        }
+        else
+        {
+            for (const auto& datagram : build_fragments(m_sender_id, message_id, action, payload, security))
+            {
+                sent &= m_multicast_sender->send_datagram(datagram);
+                datagram_bytes += datagram.size();
+                metrics.add(Metrics::Counter::FragmentsSent);
+            }
+        }
+    }
+    CLIPNET_PROBE4(datagram_sent, m_sender_id, message_id, datagram_bytes, static_cast<int>(sent));
+
+    qint64 mark{0};
+    record.stage_us[3] = lap_us(send_timer, mark);
+    record.datagram_bytes = static_cast<uint32_t>(datagram_bytes);
+    record.outcome = sent ? flight::Outcome::Sent : flight::Outcome::SendFailed;
+    FlightRecorder::instance().record(record);
+
+    if (sent)
+    {
+        metrics.add(Metrics::Counter::MessagesSent);
+        metrics.add(Metrics::Counter::BytesSent, static_cast<uint64_t>(datagram_bytes));
+    }
+    else
+        metrics.add(Metrics::Counter::SendFailures);
+
+    if(m_settings.audio_cue)
+    {
+        // the audio engine starts with the first cue, not at startup
+        cue()->slot_set_audio_enabled(true);
+        QTimer::singleShot(0, cue(), &Cue::slot_trigger_audio);
+    }
+    if(m_settings.visual_cue && !display.isEmpty())
+        QTimer::singleShot(0, cue(), std::bind(&Cue::slot_trigger_visual, cue(), display));
+}
+
+void MainWindow::log(LogModel::Severity severity, const QString& text)
+{
+    m_log_model->append(severity, text);
+}
+
+void MainWindow::slot_log_rows_inserted()
+{
+    // follow the tail, unless the user has scrolled back to read something
+    auto scroll_bar{m_ui->list_Log->verticalScrollBar()};
+    if (scroll_bar->value() >= scroll_bar->maximum() - 1)
+        m_ui->list_Log->scrollToBottom();
+}
+
+QJsonObject MainWindow::statistics_snapshot() const
+{
+    auto snapshot{Metrics::instance().snapshot()};
+
+    // put names to the peer ids where we know them
+    QJsonArray peers;
+    for (const auto& value : snapshot["peers"].toArray())
+    {
+        auto peer{value.toObject()};
+        auto name{m_peer_names.value(peer["peer"].toString().toInt(nullptr, 16))};
+        if (!name.isEmpty())
+            peer["host"] = name;
+        peers.append(peer);
+    }
+    snapshot["peers"] = peers;
+
+    snapshot["host"] = m_host_name;
+    snapshot["sender"] = QString::number(m_sender_id, 16);
+    snapshot["member"] = m_multicast_group_member;
+
+    return snapshot;
+}
+
+void MainWindow::slot_refresh_statistics()
+{
+    // only do the work while someone is actually looking
+    m_wheel.cancel(m_statistics_timer);
+    m_statistics_timer = 0;
+
+    if (!isVisible() || m_ui->toolBox->currentWidget() != m_ui->page_Statistics)
+        return;
+
+    m_statistics_timer = m_wheel.schedule(1000, this, [this]() { slot_refresh_statistics(); });
+
+    auto snapshot{statistics_snapshot()};
+
+    auto histogram_row = [](const QString& label, const QJsonObject& h) {
+        return QString("  %1 %2 %3 %4 %5 %6")
+            .arg(label, -24)
+            .arg(h["count"].toDouble(), 10, 'f', 0)
+            .arg(h["mean"].toDouble(), 10, 'f', 1)
+            .arg(h["p50"].toDouble(), 10, 'f', 0)
+            .arg(h["p99"].toDouble(), 10, 'f', 0)
+            .arg(h["max"].toDouble(), 10, 'f', 0);
+    };
+
+    QStringList lines;
+
+    lines << tr("Counters");
+    auto counters{snapshot["counters"].toObject()};
+    for (auto i = counters.constBegin(); i != counters.constEnd(); ++i)
+        lines << QString("  %1 %2").arg(i.key(), -24).arg(i.value().toDouble(), 12, 'f', 0);
+
+    lines << QString() << QString("%1 %2 %3 %4 %5 %6").arg(tr("Stages"), -26).arg("count", 10).arg("mean", 10).arg("p50", 10).arg("p99", 10).arg("max", 10);
+    auto histograms{snapshot["histograms"].toObject()};
+    for (auto i = histograms.constBegin(); i != histograms.constEnd(); ++i)
+        lines << histogram_row(i.key(), i.value().toObject());
+
+    lines << QString() << tr("End-to-end latency by peer (ms; depends on clock synchronization)");
+    for (const auto& value : snapshot["peers"].toArray())
+    {
+        auto peer{value.toObject()};
+        auto label{peer.contains("host") ? peer["host"].toString() : peer["peer"].toString()};
+        lines << histogram_row(label, peer["latency_ms"].toObject());
+    }
+
+    m_ui->edit_Statistics->setPlainText(lines.join("\n"));
+}
+
+void MainWindow::slot_set_control_states()
+{
+    if (!m_ui)
+        return;
+
+    bool ipv4_enabled{m_ui->check_Channels_IPv4->isChecked()};
+    bool ipv6_enabled{m_ui->check_Channels_IPv6->isChecked()};
+
+    m_ui->line_MulticastGroupPort->setEnabled(!m_multicast_group_member);
+
+    m_ui->line_MulticastGroupIPv4->setEnabled(ipv4_enabled && !m_multicast_group_member);
+    m_ui->button_MulticastGroupIPv4_Randomize->setEnabled(ipv4_enabled && !m_multicast_group_member);
+
+    m_ui->line_MulticastGroupIPv6->setEnabled(ipv6_enabled && !m_multicast_group_member);
+    m_ui->button_MulticastGroupIPv6_Randomize->setEnabled(ipv6_enabled && !m_multicast_group_member);
+
+    m_ui->check_Channels_AutoRejoin->setEnabled(!m_multicast_group_member);
+
+#if defined(USE_ENCRYPTION)
+    auto use_encryption{m_ui->check_Encryption->isChecked()};
+    m_ui->check_Encryption->setEnabled(!m_multicast_group_member);
+    // a new passphrase can be staged while joined, but not introduced
+    m_ui->line_Passphrase->setEnabled(use_encryption && (!m_multicast_group_member || m_keys.current()));
+#endif
+
+    auto clear_clipboard{m_ui->check_ClearClipboard->isChecked()};
+    m_ui->check_ClearClipboard->setEnabled(!m_multicast_group_member);
+    m_ui->line_ClearClipboardSeconds->setEnabled(clear_clipboard && !m_multicast_group_member);
+}
+
+void MainWindow::slot_tray_menu_action(QAction* /*action*/)
+{}
+
+void MainWindow::slot_populate_history_menu()
+{
+    m_history_menu->clear();
+
+    auto add_note = [this](const QString& text) { m_history_menu->addAction(text)->setEnabled(false); };
+
+    if (!m_history->is_open())
+        add_note(tr("History is disabled"));
+    else if (!m_history->is_loaded())
+        add_note(tr("Loading..."));
+    else if (m_history->entries().empty())
+        add_note(tr("Nothing copied yet"));
+    else
+    {
+        const auto& entries{m_history->entries()};
+        auto count{qMin<size_t>(entries.size(), history_menu_entries)};
+
+        // newest first
+        for (auto iter = entries.rbegin(); iter != entries.rbegin() + static_cast<std::ptrdiff_t>(count); ++iter)
+        {
+            auto when{QDateTime::fromMSecsSinceEpoch(iter->timestamp)};
+            auto label{QString("%1\t%2 %3").arg(QString(iter->preview).replace("&", "&&"), iter->host, when.toString("ddd hh:mm"))};
+
+            auto action{m_history_menu->addAction(label)};
+            action->setData(QVariant::fromValue<qulonglong>(iter->id));
+        }
+    }
+
+    if (m_history->is_open())
+    {
+        m_history_menu->addSeparator();
+        m_history_menu->addAction(m_history_search_action);
+    }
+}
+
+void MainWindow::slot_recall_history(QAction* action)
+{
+    auto id{action->data().toULongLong()};
+    if (id)
+        recall_history(id);
+}
+
+void MainWindow::slot_recall_history_item(QListWidgetItem* item)
+{
+    auto id{item->data(Qt::UserRole).toULongLong()};
+    if (id)
+        recall_history(id);
+}
+
+void MainWindow::slot_search_history()
+{
+    // nobody is looking
+    if (!isVisible())
+        return;
+
+    m_history_search_timer.start();
+
+    auto query{m_ui->line_HistorySearch->text()};
+    if (!query.isEmpty())
+    {
+        // the results arrive with slot_history_searched()
+        m_ui->label_HistoryStatus->setText(tr("Searching..."));
+        m_history->search(query, history_search_results);
+        return;
+    }
+
+    std::vector<History::Entry> results;
+    const auto& entries{m_history->entries()};
+    for (auto iter = entries.rbegin(); iter != entries.rend() && results.size() < static_cast<size_t>(history_search_results); ++iter)
+        results.push_back(*iter);
+
+    slot_history_searched(query, results);
+}
+
+void MainWindow::slot_history_searched(const QString& query, const std::vector<History::Entry>& results)
+{
+    // typing has moved on since this search started
+    if (query != m_ui->line_HistorySearch->text())
+        return;
+
+    auto elapsed_ms{static_cast<double>(m_history_search_timer.nsecsElapsed()) / 1000000.0};
+
+    m_ui->list_History->clear();
+    for (const auto& entry : results)
+    {
+        auto when{QDateTime::fromMSecsSinceEpoch(entry.timestamp)};
+        auto item{new QListWidgetItem(QString("%1  %2  %3").arg(when.toString("ddd hh:mm"), entry.host, entry.preview), m_ui->list_History)};
+        item->setData(Qt::UserRole, QVariant::fromValue<qulonglong>(entry.id));
+    }
+
+    if (!m_history->is_open())
+        m_ui->label_HistoryStatus->setText(tr("History is disabled"));
+    else if (!m_history->is_loaded())
+        m_ui->label_HistoryStatus->setText(tr("Loading the history..."));
+    else if (query.isEmpty())
+        m_ui->label_HistoryStatus->setText(tr("%1 entries").arg(m_history->entries().size()));
+    else
+        m_ui->label_HistoryStatus->setText(tr("%1 matches in %2 ms").arg(results.size()).arg(elapsed_ms, 0, 'f', 2));
+}
+
+void MainWindow::recall_history(uint64_t id)
+{
+    History::Content content;
+    if (!m_history->content(id, content))
+    {
+        log(LogModel::Severity::Warning, tr("Could not read the history entry"));
+        return;
+    }
+
+    // this is an ordinary local copy from here on, so the group receives it too
+    auto data = new QMimeData();
+    data->setText(content.text);
+    if (!content.html.isEmpty())
+        data->setHtml(content.html);
+    m_clipboard->setMimeData(data);
+
+    log(LogModel::Severity::Info, tr("Recalled a clipboard entry from %1").arg(content.host));
+}
+
+void MainWindow::slot_tray_message_clicked()
+{
+    QMessageBox::information(
+        nullptr,
+        tr("ClipNet"),
+        tr("Sorry, I already gave what help I could.\n"
+           "Maybe you should try asking a human?"));
+}
+
+void MainWindow::slot_tray_icon_activated(QSystemTrayIcon::ActivationReason reason)
+{
+    switch (reason)
+    {
+        case QSystemTrayIcon::Trigger:
+            setVisible(!isVisible());
+            if (isVisible())
+                activateWindow();
+            break;
+
+        case QSystemTrayIcon::DoubleClick:
+        case QSystemTrayIcon::MiddleClick:
+        default:
+            break;
+    }
+}
+
+void MainWindow::slot_process_peer_event(const QByteArray& datagram)
+{
+    TraceScope event_scope(Trace::Stage::PeerEvent);
+
+    auto& metrics{Metrics::instance()};
+    metrics.add(Metrics::Counter::DatagramsReceived);
+    metrics.add(Metrics::Counter::BytesReceived, static_cast<uint64_t>(datagram.size()));
+
+    auto& recorder{FlightRecorder::instance()};
+
+    auto packet{parse_packet(datagram)};
+    if (!packet)
+    {
+        metrics.add(Metrics::Counter::Malformed);
+        CLIPNET_PROBE3(packet_rejected, 0, 0, static_cast<int>(RejectReason::Malformed));
+
+        auto record{flight_record(flight::Direction::Incoming, 0, 0)};
+        record.datagram_bytes = static_cast<uint32_t>(datagram.size());
+        record.outcome = flight::Outcome::Malformed;
+        recorder.record(record);
+        return;
+    }
+
+    CLIPNET_PROBE3(datagram_received, packet->sender, packet->message_id, datagram.size());
+
+    if (packet->sender == m_sender_id)
+    {
+        metrics.add(Metrics::Counter::OwnPackets);
+        return;
+    }
+
+    event_scope.set_message(packet->sender, packet->message_id);
+
+    auto record{flight_record(flight::Direction::Incoming, packet->sender, packet->message_id)};
+    record.datagram_bytes = static_cast<uint32_t>(datagram.size());
+    record.payload_bytes = static_cast<uint32_t>(packet->payload_size);
+
+    QElapsedTimer stage_timer;
+    stage_timer.start();
+    qint64 mark{0};
+
+    // the group tag names the key the packet was produced with, which may
+    // be the one a passphrase change is moving the group to, or away from
+    auto security{m_keys.find(packet->group_tag)};
+
+    bool verified{false};
+    {
+        TraceScope scope(Trace::Stage::Verify, packet->sender, packet->message_id);
+        verified = (security || !m_keys.current()) && verify_packet(packet, security);
+    }
+    record.stage_us[0] = lap_us(stage_timer, mark);
+
+    if (!verified)
+    {
+        // a different passphrase, or another ClipNet group sharing the
+        // port; either way, there is nothing here we could decrypt
+        metrics.add(Metrics::Counter::Rejected);
+        CLIPNET_PROBE3(packet_rejected, packet->sender, packet->message_id, static_cast<int>(RejectReason::GroupMismatch));
+
+        record.outcome = flight::Outcome::Rejected;
+        recorder.record(record);
+
+        if (!m_rejected_senders.contains(packet->sender))
+        {
+            m_rejected_senders.insert(packet->sender);
+
+            log(LogModel::Severity::Warning,
+                QString("Peer %1: Ignoring packets that were not produced with our passphrase").arg(packet->sender, 0, 16));
+        }
+        return;
+    }
+
+    // members choose their ciphers independently; we can only read the
+    // ones this build includes, and only accept those we consider strong
+    // enough
+    auto cipher{crypto::Cipher::none};
+    auto acceptable{packet->cipher <= crypto::max_cipher};
+    if (acceptable)
+    {
+        cipher = static_cast<crypto::Cipher>(packet->cipher);
+        acceptable = !security || (security->supports(cipher) && cipher >= m_minimum_cipher);
+    }
+
+    if (!acceptable)
+    {
+        // a policy decision, not a bad key; kept apart so the two can be told apart
+        metrics.add(Metrics::Counter::CipherRejected);
+        CLIPNET_PROBE3(packet_rejected, packet->sender, packet->message_id, static_cast<int>(RejectReason::CipherRejected));
+
+        record.outcome = flight::Outcome::CipherRejected;
+        recorder.record(record);
+
+        if (!m_rejected_senders.contains(packet->sender))
+        {
+            m_rejected_senders.insert(packet->sender);
+
+            log(LogModel::Severity::Warning,
+                QString("Peer %1: Ignoring packets encrypted with a cipher (%2) this build does not include or accept").arg(packet->sender, 0, 16).arg(packet->cipher));
+        }
+        return;
+    }
+
+    // a peer has switched to the staged key, so the group is moving
+    if (security && security == m_keys.next())
+        promote_keys(tr("Peer %1 switched to the new passphrase").arg(packet->sender, 0, 16));
+
+    switch (static_cast<Action>(packet->action))
+    {
+        case Action::ClipData:
+        case Action::CompressedClipData:
+        case Action::Preview:
+            {
+                // the datagram is shared, not copied
+                Incoming incoming;
+                incoming.data = datagram;
+                incoming.payload_offset = static_cast<int>(offsetof(Packet, payload));
+                incoming.payload_size = packet->payload_size;
+                incoming.action = static_cast<Action>(packet->action);
+                incoming.sender = packet->sender;
+                incoming.message_id = packet->message_id;
+                incoming.security = security;
+                incoming.cipher = cipher;
+                incoming.record = record;
+
+                queue_incoming(incoming);
+            }
+            break;
+
+        case Action::Fragment:
+            receive_fragment(packet, security, cipher, record);
+            break;
+
+        default:
+            break;
+    }
+}
+
+void MainWindow::queue_incoming(const Incoming& incoming)
+{
+    // decryption and parsing grow with the payload, so they are done off
+    // the GUI thread
+    auto watcher{new incoming_watcher_t(this)};
+    connect(watcher, &incoming_watcher_t::finished, this, &MainWindow::slot_incoming_ready);
+    m_incoming.push_back(watcher);
+
+    watcher->setFuture(QtConcurrent::run(&MainWindow::decode_incoming, incoming));
+}
+
+void MainWindow::receive_fragment(const Packet* packet, const secure_ptr_t& security, crypto::Cipher cipher, flight::Record& record)
+{
+    constexpr int piece_size{max_datagram_payload - static_cast<int>(sizeof(Fragment))};
+
+    auto& metrics{Metrics::instance()};
+
+    auto fragment{parse_fragment(packet)};
+    if (!fragment || fragment->body_size > static_cast<uint32_t>(max_body_size))
+    {
+        metrics.add(Metrics::Counter::Malformed);
+        record.outcome = flight::Outcome::Malformed;
+        FlightRecorder::instance().record(record);
+        return;
+    }
+
+    metrics.add(Metrics::Counter::FragmentsReceived);
+
+    auto key{(static_cast<quint64>(static_cast<uint32_t>(packet->sender)) << 32) | packet->message_id};
+    auto found{m_reassembly.find(key)};
+
+    if (found == m_reassembly.end())
+    {
+        auto active{std::count_if(m_reassembly.cbegin(), m_reassembly.cend(), [](const Reassembly& r) { return !r.complete; })};
+        if (active >= max_reassemblies || m_reassembly_bytes + fragment->body_size > max_reassembly_bytes)
+        {
+            metrics.add(Metrics::Counter::Malformed);
+            record.outcome = flight::Outcome::Malformed;
+            FlightRecorder::instance().record(record);
+            return;
+        }
+
+        found = m_reassembly.insert(key, Reassembly());
+        auto& reassembly{found.value()};
+
+        // a body whose fragments stop arriving is given up on
+        reassembly.expiry = m_wheel.schedule(reassembly_timeout_ms, this, [this, key]() { release_reassembly(key); });
+
+        reassembly.body = QByteArray(static_cast<int>(fragment->body_size), Qt::Uninitialized);
+        reassembly.received.assign(fragment->count, false);
+        reassembly.remaining = fragment->count;
+        reassembly.action = static_cast<Action>(fragment->action);
+        reassembly.security = security;
+        reassembly.cipher = cipher;
+        reassembly.record = record;
+        reassembly.record.datagram_bytes = 0;
+
+        m_reassembly_bytes += reassembly.body.size();
+    }
+
+    auto& reassembly{found.value()};
+
+    // a member of both the IPv4 and IPv6 groups gets every datagram twice
+    if (reassembly.complete)
+        return;
+
+    // the sender switched keys part way through; the body cannot be decrypted
+    if (security != reassembly.security || cipher != reassembly.cipher)
+        return;
+
+    auto offset{static_cast<int>(fragment->index) * piece_size};
+    auto size{packet->payload_size - static_cast<int>(sizeof(Fragment))};
+    auto last{fragment->index + 1 == fragment->count};
+
+    if (fragment->count != reassembly.received.size() || fragment->body_size != static_cast<uint32_t>(reassembly.body.size()) ||
+        (last ? offset + size != reassembly.body.size() : size != piece_size))
+    {
+        metrics.add(Metrics::Counter::Malformed);
+        return;
+    }
+
+    if (reassembly.received[fragment->index])
+        return;
+
+    ::memcpy(reassembly.body.data() + offset, &packet->payload[sizeof(Fragment)], static_cast<size_t>(size));
+    reassembly.received[fragment->index] = true;
+    reassembly.record.datagram_bytes += record.datagram_bytes;
+
+    if (--reassembly.remaining)
+        return;
+
+    if (reassembly.action == Action::ClipData || reassembly.action == Action::CompressedClipData)
+    {
+        Incoming incoming;
+        incoming.data = reassembly.body;
+        incoming.payload_size = reassembly.body.size();
+        incoming.action = reassembly.action;
+        incoming.sender = packet->sender;
+        incoming.message_id = packet->message_id;
+        incoming.security = reassembly.security;
+        incoming.cipher = reassembly.cipher;
+        incoming.record = reassembly.record;
+        incoming.record.payload_bytes = static_cast<uint32_t>(reassembly.body.size());
+
+        queue_incoming(incoming);
+    }
+
+    reassembly.complete = true;
+    m_reassembly_bytes -= reassembly.body.size();
+    reassembly.body = QByteArray();
+    reassembly.received.clear();
+}
+
+void MainWindow::release_reassembly(quint64 key)
+{
+    auto found{m_reassembly.find(key)};
+    if (found == m_reassembly.end())
+        return;
+
+    m_reassembly_bytes -= found->body.size();
+    m_reassembly.erase(found);
+}
+
+MainWindow::Incoming MainWindow::decode_incoming(Incoming incoming)
+{
+    auto& record{incoming.record};
+
+    QElapsedTimer stage_timer;
+    stage_timer.start();
+    qint64 mark{0};
+
+    auto buffer{QByteArray::fromRawData(incoming.data.constData() + incoming.payload_offset, incoming.payload_size)};
+
+#ifdef USE_ENCRYPTION
+    bool success{false};
+    if (incoming.security)
+    {
+        TraceScope scope(Trace::Stage::Decrypt, incoming.sender, incoming.message_id);
+        buffer = incoming.security->decrypt(buffer, incoming.cipher, success);
+    }
+    CLIPNET_PROBE4(decrypt_done, incoming.sender, incoming.message_id, buffer.size(), static_cast<int>(success));
+    record.stage_us[1] = lap_us(stage_timer, mark);
+    if (!success)
+    {
+        CLIPNET_PROBE3(packet_rejected, incoming.sender, incoming.message_id, static_cast<int>(RejectReason::DecryptFailed));
+        record.outcome = flight::Outcome::DecryptFailed;
+        return incoming;
+    }
+#endif
+
+    auto parsed{payload::parse(buffer, incoming.action, incoming.sender, incoming.message_id)};
+    const auto& json{parsed.json};
+    const auto& text_block{parsed.text_block};
+    const auto& html_block{parsed.html_block};
+    record.stage_us[2] = lap_us(stage_timer, mark);
+    if (json.isNull())
+    {
+        CLIPNET_PROBE3(packet_rejected, incoming.sender, incoming.message_id, static_cast<int>(RejectReason::ParseFailed));
+        record.outcome = flight::Outcome::ParseFailed;
+        return incoming;
+    }
 
-#if defined(USE_ENCRYPTION)
-    connect(m_ui->check_Encryption, &QCheckBox::clicked, this, &MainWindow::slot_set_control_states);
-#else
-    m_ui->check_Encryption->setVisible(false);
-    m_ui->line_Passphrase->setVisible(false);
-#endif
+    incoming.host = json["host"].toString();
+    incoming.content_hash = json["hash"].toVariant().toUInt();
 
-    connect(m_ui->check_ClearClipboard, &QCheckBox::clicked, this, &MainWindow::slot_clear_clipboard);
+    auto stamp{json["hlc"].toObject()};
+    if (!stamp.isEmpty())
+    {
+        incoming.stamp.wall = stamp["wall"].toVariant().toLongLong();
+        incoming.stamp.count = stamp["count"].toVariant().toUInt();
+        incoming.stamp.node = incoming.sender;
+    }
 
-    m_restore_action = new QAction(QIcon(":/images/Restore.png"), tr("&Restore"), this);
-    connect(m_restore_action, &QAction::triggered, this, &MainWindow::showNormal);
+    ClipMimeData* data{nullptr};
+    if (incoming.action == Action::Preview)
+    {
+        incoming.preview = true;
+        incoming.text = json["preview"].toString();
+        incoming.size = json["size"].toInt();
 
-    m_quit_action = new QAction(QIcon(":/images/Quit.png"), tr("&Quit"), this);
-    connect(m_quit_action, &QAction::triggered, this, &MainWindow::slot_quit);
+        data = new ClipMimeData(incoming.text, json["has_html"].toBool());
+    }
+    else if (incoming.action == Action::CompressedClipData)
+    {
+        incoming.sent = json["sent"].toVariant().toLongLong();
 
-    m_trayIcon = new QSystemTrayIcon(this);
-    connect(m_trayIcon, &QSystemTrayIcon::messageClicked, this, &MainWindow::slot_tray_message_clicked);
-    connect(m_trayIcon, &QSystemTrayIcon::activated, this, &MainWindow::slot_tray_icon_activated);
+        // nothing is inflated until an application asks for it; the
+        // history, too, keeps the blocks as they are
+        data = ClipMimeData::from_blocks(text_block, html_block, incoming.sender, incoming.message_id);
 
-    m_trayIcon->setIcon(QIcon(":/images/ClipNet.png"));
-    m_trayIcon->setToolTip(tr("ClipNet"));
-    build_tray_menu();
+        incoming.text_block = text_block;
+        incoming.html_block = html_block;
+        incoming.excerpt = json["excerpt"].toString();
+    }
+    else
+    {
+        incoming.text = json["text"].toString();
+        incoming.html = json["html"].toString();
+        incoming.sent = json["sent"].toVariant().toLongLong();
 
-    m_trayIcon->show();
+        // the text may be left for the clipboard data to derive from the HTML
+        data = new ClipMimeData(incoming.text, incoming.html);
+    }
 
-    m_clipboard = QGuiApplication::clipboard();
+    // QClipboard takes it over on the GUI thread
+    data->moveToThread(QCoreApplication::instance()->thread());
+    incoming.mime_data = data;
 
-    QDir::setCurrent(qApp->applicationDirPath());
+    Metrics::instance().record(Metrics::Histogram::DecodeMicroseconds, static_cast<uint64_t>(stage_timer.nsecsElapsed() / 1000));
 
-    m_cue = CuePointer(new Cue());
+    return incoming;
 }
 
-void MainWindow::build_tray_menu()
+void MainWindow::slot_incoming_ready()
 {
-    if (m_trayIconMenu)
+    // copies are applied in the order they arrived, however the workers finish
+    while (!m_incoming.empty() && m_incoming.front()->isFinished())
     {
-        disconnect(m_trayIconMenu, &QMenu::triggered, this, &MainWindow::slot_tray_menu_action);
-        delete m_trayIconMenu;
-    }
-
-    m_trayIconMenu = new QMenu(this);
+        auto watcher{m_incoming.front()};
+        m_incoming.pop_front();
 
-    //trayIconMenu->addSeparator();
+        auto incoming{watcher->result()};
+        watcher->deleteLater();
 
-    m_trayIconMenu->addAction(m_restore_action);
-    m_trayIconMenu->addAction(m_quit_action);
+        if (!incoming.mime_data)
+        {
+            // nothing to apply, only failures to account for
+            apply_incoming(incoming);
+            continue;
+        }
 
-    m_trayIcon->setContextMenu(m_trayIconMenu);
+        if (incoming.stamp.is_set())
+            m_clock.update(incoming.stamp);
 
-    connect(m_trayIconMenu, &QMenu::triggered, this, &MainWindow::slot_tray_menu_action);
+        if (incoming.preview)
+        {
+            // a preview replaces stale content at once, outside the window;
+            // that is its point
+            if (later_than(incoming.stamp, m_clipboard_stamp))
+                apply_preview(incoming);
+            else
+                delete incoming.mime_data;
+        }
+        else if (completes_preview(incoming))
+            apply_incoming(incoming);
+        else if (!later_than(incoming.stamp, m_clipboard_stamp))
+            // the clipboard already holds a later copy; every member that
+            // sees both comes to the same conclusion, so none echoes it
+            supersede_incoming(incoming);
+        else
+        {
+            // every setMimeData() takes clipboard ownership and wakes every
+            // application watching the clipboard, so a copy is held until
+            // the window it opens closes, and only the newest copy of the
+            // burst is applied then
+            if (!m_wheel.is_pending(m_apply_window))
+                open_apply_window();
+
+            if (!m_newest_incoming.mime_data)
+                m_newest_incoming = incoming;
+            else if (later_than(incoming.stamp, m_newest_incoming.stamp))
+            {
+                supersede_incoming(m_newest_incoming);
+                m_newest_incoming = incoming;
+            }
+            else
+                supersede_incoming(incoming);
+        }
+    }
 }
 
-void MainWindow::setVisible(bool visible)
+bool MainWindow::later_than(const hlc::Timestamp& a, const hlc::Timestamp& b)
 {
-    //restoreAction->setEnabled(isMaximized() || !visible);
-    QWidget::setVisible(visible);
+    // copies from peers without a clock are taken in arrival order
+    if (!a.is_set() || !b.is_set())
+        return true;
+    return b < a;
 }
 
-void MainWindow::closeEvent(QCloseEvent* event)
+void MainWindow::slot_apply_newest()
 {
-    if (m_trayIcon->isVisible())
+    if (!m_newest_incoming.mime_data)
+        return;
+
+    // a local copy made during the window is later still
+    if (!later_than(m_newest_incoming.stamp, m_clipboard_stamp))
     {
-        //QMessageBox::information(this,
-        //                         tr("Tray"),
-        //                         tr("The program will keep running in the "
-        //                            "system tray. To terminate the program, "
-        //                            "choose <b>Quit</b> in the context menu "
-        //                            "of the system tray entry."));
-        hide();
-        event->ignore();
+        supersede_incoming(m_newest_incoming);
+        m_newest_incoming = Incoming();
+        return;
     }
+
+    // anything arriving after this opens a window of its own
+    apply_incoming(m_newest_incoming);
+    m_newest_incoming = Incoming();
 }
 
-void MainWindow::load_settings()
+void MainWindow::open_apply_window()
 {
-    m_multicast_group_member = false;
-
-    QString settings_file_name;
-#ifdef QT_WIN
-    settings_file_name = QDir::toNativeSeparators(QString("%1/ClipNet/Settings.ini").arg(qgetenv("APPDATA").constData()));
-#endif
-#ifdef QT_LINUX
-    settings_file_name = QDir::toNativeSeparators(QString("%1/ClipNet.ini").arg(QStandardPaths::standardLocations(QStandardPaths::ConfigLocation)[0]));
-#endif
-    QSettings settings(settings_file_name, QSettings::IniFormat);
+    m_apply_window = m_wheel.schedule(apply_window_ms, this, [this]() {
+        m_apply_window = 0;
+        slot_apply_newest();
+    });
+}
 
-    m_ui->check_AutoStart->setChecked(settings.value("startup_enabled", false).toBool());
+void MainWindow::apply_incoming(Incoming& incoming)
+{
+    auto& metrics{Metrics::instance()};
+    auto& record{incoming.record};
 
-    m_ui->check_AudioCue->setChecked(settings.value("audio_cue", false).toBool());
-    m_ui->check_VisualCue->setChecked(settings.value("visual_cue", false).toBool());
+    if (!incoming.mime_data)
+    {
+        if (record.outcome == flight::Outcome::DecryptFailed)
+        {
+            metrics.add(Metrics::Counter::DecryptFailures);
+            log(LogModel::Severity::Warning, QString("Peer %1: Could not decrypt clipboard event").arg(incoming.sender, 0, 16));
+        }
+        else
+        {
+            metrics.add(Metrics::Counter::ParseFailures);
+            log(LogModel::Severity::Warning, QString("Peer %1: Could not parse clipboard event").arg(incoming.sender, 0, 16));
+        }
 
-    m_ui->line_MulticastGroupPort->setText(settings.value("group_port", "").toString());
+        FlightRecorder::instance().record(record);
+        return;
+    }
 
-    //    m_protocol = static_cast<Protocol>(settings.value("protocol", 0).toInt());
+    m_peer_names[incoming.sender] = incoming.host;
 
-    //    m_ui->group_MulticastGroupIPv4->setChecked(settings.value("ipv4_multicast_group_enabled", true).toBool());
-    m_ui->check_Channels_IPv4->setChecked(settings.value("ipv4_multicast_group_enabled", false).toBool());
-    m_ui->line_MulticastGroupIPv4->setText(settings.value("ipv4_multicast_group_address", "").toString());
+    QElapsedTimer stage_timer;
+    stage_timer.start();
+    qint64 mark{0};
 
-    m_ui->check_Channels_IPv6->setChecked(settings.value("ipv6_multicast_group_enabled", false).toBool());
-    m_ui->line_MulticastGroupIPv6->setText(settings.value("ipv6_multicast_group_address", "").toString());
+    if (completes_preview(incoming))
+    {
+        // the clipboard already holds this copy; only its body was missing
+        TraceScope scope(Trace::Stage::Apply, incoming.sender, incoming.message_id);
 
-    m_ui->check_Channels_AutoRejoin->setChecked(settings.value("channels_autorejoin", false).toBool());
+        m_pending_mime->fulfil(*incoming.mime_data);
+        m_pending_mime.clear();
 
-#ifdef USE_ENCRYPTION
-    m_ui->check_Encryption->setChecked(settings.value("use_encryption", false).toBool());
-    auto passphrase{settings.value("passphrase", "").toString()};
-    m_ui->line_Passphrase->setText(passphrase);
-#endif
+        delete incoming.mime_data;
+        incoming.mime_data = nullptr;
+    }
+    else
+    {
+        TraceScope scope(Trace::Stage::Apply, incoming.sender, incoming.message_id);
+        QSignalBlocker blocker(m_clipboard);
 
-    m_ui->check_ClearClipboard->setChecked(settings.value("clear_clipboard", false).toBool());
-    m_ui->line_ClearClipboardSeconds->setText(settings.value("clear_clipboard_seconds", "").toString());
+        ++m_clipboard_debt;
 
-    if (m_ui->check_ClearClipboard->isChecked())
-        m_housekeeping_timer.start();
+        m_clipboard->setMimeData(incoming.mime_data);
+        incoming.mime_data = nullptr;
+    }
+    if (m_poller)
+        m_poller->rebase();
 
-    QTimer::singleShot(0, this, &MainWindow::slot_set_control_states);
+    m_clipboard_stamp = incoming.stamp;
 
-    if (!m_ui->check_Channels_AutoRejoin->isChecked())
-        // open the main window to remind them that they need
-        // to initiate the connection manually
-        showNormal();
+    // a compressed copy is reported by its compressed sizes; nothing of it has been inflated
+    if (incoming.action == Action::CompressedClipData)
+        CLIPNET_PROBE4(clipboard_applied, incoming.sender, incoming.message_id, incoming.text_block.size(), incoming.html_block.size());
     else
-        QTimer::singleShot(0, this, &MainWindow::slot_multicast_group_join);
-}
+        CLIPNET_PROBE4(clipboard_applied, incoming.sender, incoming.message_id, incoming.text.size(), incoming.html.size());
 
-void MainWindow::save_settings()
-{
-    QString settings_file_name;
-#ifdef QT_WIN
-    settings_file_name = QDir::toNativeSeparators(QString("%1/ClipNet/Settings.ini").arg(qgetenv("APPDATA").constData()));
-#endif
-#ifdef QT_LINUX
-    settings_file_name = QDir::toNativeSeparators(QString("%1/ClipNet.ini").arg(QStandardPaths::standardLocations(QStandardPaths::ConfigLocation)[0]));
-#endif
-    QSettings settings(settings_file_name, QSettings::IniFormat);
+    record.stage_us[3] = lap_us(stage_timer, mark);
+    metrics.record(Metrics::Histogram::ApplyMicroseconds, record.stage_us[3]);
+    metrics.add(Metrics::Counter::MessagesApplied);
 
-    settings.clear();
+    record.outcome = flight::Outcome::Applied;
+    FlightRecorder::instance().record(record);
 
-    settings.setValue("startup_enabled", m_ui->check_AutoStart->isChecked());
+    // wall clocks between machines are only as good as their
+    // time synchronization, so this is an approximation
+    if (incoming.sent)
+        metrics.record_peer_latency(incoming.sender, static_cast<uint64_t>(qMax<qint64>(0, QDateTime::currentMSecsSinceEpoch() - incoming.sent)));
 
-    settings.setValue("audio_cue", m_ui->check_AudioCue->isChecked());
-    settings.setValue("visual_cue", m_ui->check_VisualCue->isChecked());
+    if (m_settings.clear_clipboard)
+    {
+        // each copy from the group restarts the countdown
+        m_wheel.cancel(m_clear_clipboard_timer);
+        m_clear_clipboard_timer = 0;
+
+        auto seconds{m_settings.clear_clipboard_seconds.toInt()};
+        if (seconds > 0)
+            m_clear_clipboard_timer = m_wheel.schedule(seconds * 1000, this, [this]() {
+                m_clear_clipboard_timer = 0;
+                m_clipboard->setText("");
+            });
+    }
 
-    settings.setValue("group_port", m_ui->line_MulticastGroupPort->text());
+    record_history(incoming);
 
-    settings.setValue("ipv4_multicast_group_enabled", m_ui->check_Channels_IPv4->isChecked());
-    settings.setValue("ipv4_multicast_group_address", m_ui->line_MulticastGroupIPv4->text());
+    log(LogModel::Severity::Info, QString("Peer %1: Clipboard event").arg(incoming.host));
+}
 
-    settings.setValue("ipv6_multicast_group_enabled", m_ui->check_Channels_IPv6->isChecked());
-    settings.setValue("ipv6_multicast_group_address", m_ui->line_MulticastGroupIPv6->text());
+void MainWindow::apply_preview(Incoming& incoming)
+{
+    m_peer_names[incoming.sender] = incoming.host;
 
-    settings.setValue("channels_autorejoin", m_ui->check_Channels_AutoRejoin->isChecked());
+    {
+        TraceScope scope(Trace::Stage::Apply, incoming.sender, incoming.message_id);
+        QSignalBlocker blocker(m_clipboard);
 
-#if defined(USE_ENCRYPTION)
-    settings.setValue("use_encryption", m_ui->check_Encryption->isChecked());
-    settings.setValue("passphrase", m_ui->line_Passphrase->text());
-#endif
+        ++m_clipboard_debt;
 
-    settings.setValue("clear_clipboard", m_ui->check_ClearClipboard->isChecked());
-    settings.setValue("clear_clipboard_seconds", m_ui->line_ClearClipboardSeconds->text());
-}
+        m_clipboard->setMimeData(incoming.mime_data);
+    }
+    if (m_poller)
+        m_poller->rebase();
 
-void MainWindow::notify_clipboard_event(const QByteArray& payload, const QString& display)
-{
-    auto packet_size{static_cast<int>(sizeof(Packet)) + static_cast<int>(payload.length())};
-    auto data{QByteArray(packet_size, 0)};
-    auto packet{reinterpret_cast<Packet*>(data.data())};
+    m_clipboard_stamp = incoming.stamp;
 
-    packet->magic = magic_number;
-    packet->sender = m_sender_id;
-    packet->action = static_cast<int>(Action::ClipData);
-    packet->payload_size = static_cast<int>(payload.length());
-    ::memcpy(&packet->payload, payload.constData(), static_cast<size_t>(packet->payload_size));
+    m_pending_mime = incoming.mime_data;
+    m_pending_sender = incoming.sender;
+    m_pending_message_id = incoming.message_id;
+    m_pending_hash = incoming.content_hash;
+    m_pending_host = incoming.host;
+    m_pending_record = incoming.record;
+    incoming.mime_data = nullptr;
 
-    m_multicast_sender->send_datagram(data);
+    // fragments are neither paced nor resent, so the body may never come
+    auto pending{m_pending_mime.data()};
+    m_wheel.schedule(reassembly_timeout_ms, pending, [this, pending]() { abandon_preview(pending); });
 
-    if(m_ui->check_AudioCue->isChecked())
-        QTimer::singleShot(0, m_cue.data(), &Cue::slot_trigger_audio);
-    if(m_ui->check_VisualCue->isChecked() && !display.isEmpty())
-        QTimer::singleShot(0, m_cue.data(), std::bind(&Cue::slot_trigger_visual, m_cue.data(), display));
+    log(LogModel::Severity::Info, QString("Peer %1: Receiving a large clipboard event (%2 characters)").arg(incoming.host).arg(incoming.size));
 }
 
-void MainWindow::slot_housekeeping()
+void MainWindow::abandon_preview(ClipMimeData* pending)
 {
-    if (m_clear_clipboard_countdown != -1)
+    if (m_pending_mime != pending || !pending->is_pending())
+        return;
+
+    pending->abandon();
+    m_pending_mime.clear();
+
+    // the preview is only the start of the copy; an empty clipboard is
+    // better than pasting it as if it were the whole
     {
-        if (--m_clear_clipboard_countdown == 0)
-        {
-            // clear the clipbaord
-            m_clipboard->setText("");
-            m_clear_clipboard_countdown = -1;
-        }
+        QSignalBlocker blocker(m_clipboard);
+
+        ++m_clipboard_debt;
+
+        m_clipboard->clear();
     }
+    if (m_poller)
+        m_poller->rebase();
+
+    m_pending_record.outcome = flight::Outcome::Abandoned;
+    FlightRecorder::instance().record(m_pending_record);
+
+    log(LogModel::Severity::Warning, QString("Peer %1: A large clipboard event did not arrive in full; the clipboard was cleared").arg(m_pending_host));
 }
 
-void MainWindow::slot_set_control_states()
+bool MainWindow::completes_preview(const Incoming& incoming) const
 {
-    bool ipv4_enabled{m_ui->check_Channels_IPv4->isChecked()};
-    bool ipv6_enabled{m_ui->check_Channels_IPv6->isChecked()};
+    return m_pending_mime && m_pending_mime->is_pending() && incoming.sender == m_pending_sender &&
+           incoming.message_id == m_pending_message_id && incoming.content_hash == m_pending_hash;
+}
 
-    m_ui->line_MulticastGroupPort->setEnabled(!m_multicast_group_member);
+void MainWindow::supersede_incoming(Incoming& incoming)
+{
+    // never reaches the clipboard, but it was a copy all the same
+    delete incoming.mime_data;
+    incoming.mime_data = nullptr;
 
-    m_ui->line_MulticastGroupIPv4->setEnabled(ipv4_enabled && !m_multicast_group_member);
-    m_ui->button_MulticastGroupIPv4_Randomize->setEnabled(ipv4_enabled && !m_multicast_group_member);
+    m_peer_names[incoming.sender] = incoming.host;
 
-    m_ui->line_MulticastGroupIPv6->setEnabled(ipv6_enabled && !m_multicast_group_member);
-    m_ui->button_MulticastGroupIPv6_Randomize->setEnabled(ipv6_enabled && !m_multicast_group_member);
+    Metrics::instance().add(Metrics::Counter::Superseded);
 
-    m_ui->check_Channels_AutoRejoin->setEnabled(!m_multicast_group_member);
+    incoming.record.outcome = flight::Outcome::Superseded;
+    FlightRecorder::instance().record(incoming.record);
 
-#if defined(USE_ENCRYPTION)
-    m_use_encryption = m_ui->check_Encryption->isChecked();
-    m_ui->check_Encryption->setEnabled(!m_multicast_group_member);
-    m_ui->line_Passphrase->setEnabled(m_use_encryption && !m_multicast_group_member);
-#endif
+    record_history(incoming);
 
-    auto clear_clipboard{m_ui->check_ClearClipboard->isChecked()};
-    m_ui->check_ClearClipboard->setEnabled(!m_multicast_group_member);
-    m_ui->line_ClearClipboardSeconds->setEnabled(clear_clipboard && !m_multicast_group_member);
+    log(LogModel::Severity::Info, QString("Peer %1: Clipboard event (superseded by a later one)").arg(incoming.host));
 }
 
-void MainWindow::slot_tray_menu_action(QAction* /*action*/)
-{}
-
-void MainWindow::slot_tray_message_clicked()
+void MainWindow::record_history(const Incoming& incoming)
 {
-    QMessageBox::information(
-        nullptr,
-        tr("ClipNet"),
-        tr("Sorry, I already gave what help I could.\n"
-           "Maybe you should try asking a human?"));
+    if (incoming.action == Action::CompressedClipData)
+        m_history->append_blocks(incoming.sender, incoming.host, incoming.excerpt, incoming.text_block, incoming.html_block);
+    else
+        m_history->append(incoming.sender, incoming.host, incoming.text, incoming.html);
 }
 
-void MainWindow::slot_tray_icon_activated(QSystemTrayIcon::ActivationReason reason)
+void MainWindow::drop_pending()
 {
-    switch (reason)
+    for (auto watcher : m_outgoing)
     {
-        case QSystemTrayIcon::Trigger:
-            setVisible(!isVisible());
-            if (isVisible())
-                activateWindow();
-            break;
+        disconnect(watcher, &outgoing_watcher_t::finished, this, &MainWindow::slot_outgoing_ready);
+        watcher->deleteLater();
+    }
+    m_outgoing.clear();
 
-        case QSystemTrayIcon::DoubleClick:
-        case QSystemTrayIcon::MiddleClick:
-        default:
-            break;
+    // decoded copies own clipboard data that nobody will take now
+    auto discard = [](incoming_watcher_t* watcher) {
+        delete watcher->result().mime_data;
+        watcher->deleteLater();
+    };
+
+    for (auto watcher : m_incoming)
+    {
+        disconnect(watcher, &incoming_watcher_t::finished, this, &MainWindow::slot_incoming_ready);
+        if (watcher->isFinished())
+            discard(watcher);
+        else
+            connect(watcher, &incoming_watcher_t::finished, watcher, std::bind(discard, watcher));
     }
+    m_incoming.clear();
+
+    m_wheel.cancel(m_apply_window);
+    m_apply_window = 0;
+    delete m_newest_incoming.mime_data;
+    m_newest_incoming = Incoming();
+
+    for (const auto& reassembly : m_reassembly)
+        m_wheel.cancel(reassembly.expiry);
+    m_reassembly.clear();
+    m_reassembly_bytes = 0;
+    if (m_pending_mime)
+        m_pending_mime->abandon();
+    m_pending_mime.clear();
 }
 
-void MainWindow::slot_process_peer_event(const QByteArray& datagram)
+void MainWindow::slot_read_clipboard()
 {
-    auto packet{reinterpret_cast<const Packet*>(datagram.constData())};
-    if (packet->magic == magic_number && packet->sender != m_sender_id)
+    if(m_clipboard_debt)
     {
-        auto timestamp{QDateTime::currentDateTime().toString()};
+        --m_clipboard_debt;
+        Metrics::instance().add(Metrics::Counter::EchoSuppressions);
+    }
+    else
+        read_clipboard();
+}
 
-        switch (static_cast<Action>(packet->action))
-        {
-            case Action::ClipData:
-                {
-                    QString peer_id;
-                    QString payload_text, payload_html;
+void MainWindow::slot_clipboard_polled()
+{
+    if (read_clipboard())
+        Metrics::instance().add(Metrics::Counter::PolledChanges);
+}
 
-#ifdef USE_ENCRYPTION
-                    bool success{false};
-
-                    peer_id = QString::number(packet->sender, 16);
-
-                    QByteArray buffer(reinterpret_cast<const char*>(&packet->payload[0]), packet->payload_size);
-                    auto decrypted{m_security->decrypt(buffer, success)};
-                    if (success)
-                    {
-                        auto json{QJsonDocument::fromJson(decrypted)};
-                        peer_id = json["host"].toString();
-                        payload_text = json["text"].toString();
-                        payload_html = json["html"].toString();
-                    }
-#else
-                    auto buffer{QString::fromUtf8(reinterpret_cast<const char*>(&packet->payload[0]), packet->payload_size)};
-                    auto json{QJsonDocument::fromJson(buffer)};
-                    peer_id = json["host"].toString();
-                    payload_text = json["text"].toString();
-                    payload_html = json["html"].toString();
-#endif
+bool MainWindow::read_clipboard()
+{
+    TraceScope read_scope(Trace::Stage::ReadClipboard);
 
-                    ++m_clipboard_debt;
+    // every query can be a round trip to the clipboard's owner, so each
+    // format is asked for once
+    auto mime_data{m_clipboard->mimeData()};
+    if (!mime_data)
+        return false;
 
-                    {
-                        QSignalBlocker blocker(m_clipboard);
+    auto formats{mime_data->formats()};
+    auto has_text{formats.contains("text/plain") || formats.contains("text/uri-list")};
+    auto has_html{formats.contains("text/html")};
 
-                        auto data = new QMimeData();
+    QElapsedTimer stage_timer;
+    stage_timer.start();
+    qint64 mark{0};
 
-                        if(!payload_text.isEmpty())
-                            data->setText(payload_text);
-                        if(!payload_html.isEmpty())
-                            data->setHtml(payload_html);
+    Outgoing outgoing;
+    {
+        TraceScope scope(Trace::Stage::Snapshot);
+        if (has_text)
+            outgoing.text = mime_data->text();
+        if (!outgoing.text.isEmpty() && has_html)
+            outgoing.html = mime_data->html();
+    }
+    auto snapshot_us{lap_us(stage_timer, mark)};
 
-                        m_clipboard->setMimeData(data);
-                    }
+    // a change both notified and caught by polling is only sent once
+    if (m_poller && !m_poller->note_contents(formats, outgoing.text))
+        return false;
 
-                    if (m_ui->check_ClearClipboard->isChecked())
-                    {
-                        m_clear_clipboard_countdown = m_ui->line_ClearClipboardSeconds->text().toLongLong();
-                        if (!m_clear_clipboard_countdown)
-                            m_clear_clipboard_countdown = -1;
-                    }
+    if (outgoing.text.isEmpty())
+        return false;
 
-                    QStringList info;
-                    info << timestamp << QString("Peer %1: Clipboard event").arg(peer_id);
-                    m_ui->edit_Log->insertPlainText(QString("%1\n").arg(info.join(" :: ")));
-                    m_ui->edit_Log->ensureCursorVisible();
-                }
-                break;
+    outgoing.message_id = ++m_message_id;
+    read_scope.set_message(m_sender_id, outgoing.message_id);
+    CLIPNET_PROBE2(clipboard_changed, m_sender_id, outgoing.message_id);
 
-            default:
-                break;
-        }
+    outgoing.security = m_keys.current();
+    outgoing.record = flight_record(flight::Direction::Outgoing, m_sender_id, outgoing.message_id);
+    outgoing.record.stage_us[0] = snapshot_us;
+
+    // our copy is now the latest as far as this member knows
+    outgoing.stamp = m_clock.now();
+    m_clipboard_stamp = outgoing.stamp;
+
+    // a large copy takes a while to prepare and send; the group is told
+    // it is coming (so nobody pastes stale content) first
+    if (outgoing.text.size() + outgoing.html.size() >= progressive_threshold)
+    {
+        outgoing.content_hash = qHash(outgoing.html, qHash(outgoing.text));
+        send_preview(outgoing);
     }
+
+    // the rest is CPU work on our own copy of the data, which can take a
+    // while for a large document; the GUI thread goes back to the event
+    // loop until it is ready to send
+    auto watcher{new outgoing_watcher_t(this)};
+    connect(watcher, &outgoing_watcher_t::finished, this, &MainWindow::slot_outgoing_ready);
+    m_outgoing.push_back(watcher);
+
+    watcher->setFuture(QtConcurrent::run(&MainWindow::prepare_outgoing, outgoing, m_host_name));
+    return true;
 }
 
-void MainWindow::slot_read_clipboard()
+void MainWindow::send_preview(const Outgoing& outgoing)
 {
-    if(m_clipboard_debt)
-        --m_clipboard_debt;
-    else
-    {
-        auto mime_data{m_clipboard->mimeData()};
-        if (mime_data->hasText() || mime_data->hasHtml())
-        {
-            auto timestamp{QDateTime::currentDateTime().toString()};
-            QStringList info;
+    if (!m_multicast_sender)
+        return;
 
-            auto text{mime_data->text()};
-            if(!text.isEmpty())
-            {
-                info << timestamp << tr("Sending clipboard data to multicast group");
+    QJsonObject json;
+    json["host"] = m_host_name;
+    json["preview"] = outgoing.text.left(preview_length);
+    json["size"] = outgoing.text.size() + outgoing.html.size();
+    json["has_html"] = !outgoing.html.isEmpty();
+    json["hash"] = static_cast<qint64>(outgoing.content_hash);
+    json["hlc"] = stamp_json(outgoing.stamp);
+
+    auto payload{QJsonDocument(json).toJson(QJsonDocument::Compact)};
+
+#if defined(USE_ENCRYPTION)
+    bool success{false};
+    payload = outgoing.security->encrypt(payload, success);
+    if (!success)
+        return;
+#endif
 
-                QJsonObject json;
-                json["host"] = m_host_name;
-                json["text"] = mime_data->hasText() ? mime_data->text() : "";
-                json["html"] = mime_data->hasHtml() ? mime_data->html() : "";
+    auto datagram{build_packet(m_sender_id, outgoing.message_id, Action::Preview, payload, outgoing.security)};
+    if (m_multicast_sender->send_datagram(datagram))
+        Metrics::instance().add(Metrics::Counter::BytesSent, static_cast<uint64_t>(datagram.size()));
+}
+
+MainWindow::Outgoing MainWindow::prepare_outgoing(Outgoing outgoing, QString host_name)
+{
+    auto sender{outgoing.record.peer};
+    auto message_id{outgoing.message_id};
+
+    QElapsedTimer stage_timer;
+    stage_timer.start();
+    qint64 mark{0};
 
-                auto payload{QJsonDocument(json).toJson()};
+    QJsonObject json;
+    json["host"] = host_name;
+    json["sent"] = QDateTime::currentMSecsSinceEpoch();
+
+    json["hlc"] = stamp_json(outgoing.stamp);
+    if (outgoing.content_hash)
+        json["hash"] = static_cast<qint64>(outgoing.content_hash);
+
+    outgoing.payload = payload::build(json, outgoing.text, outgoing.html, sender, message_id, outgoing.action);
+    CLIPNET_PROBE3(payload_serialized, sender, message_id, outgoing.payload.size());
+    outgoing.record.payload_bytes = static_cast<uint32_t>(outgoing.payload.size());
+    outgoing.record.stage_us[1] = lap_us(stage_timer, mark);
 
-                // braodcast new clipboard text to peers
 #if defined(USE_ENCRYPTION)
-                bool success{false};
-                auto encrypted{m_security->encrypt(payload, success)};
-                if (success)
-                    notify_clipboard_event(encrypted, text);
+    {
+        TraceScope scope(Trace::Stage::Encrypt, sender, message_id);
+        CLIPNET_PROBE3(encrypt_start, sender, message_id, outgoing.payload.size());
+        outgoing.payload = outgoing.security->encrypt(outgoing.payload, outgoing.prepared);
+        CLIPNET_PROBE3(encrypt_end, sender, message_id, outgoing.payload.size());
+    }
+    outgoing.record.stage_us[2] = lap_us(stage_timer, mark);
 #else
-                notify_clipboard_event(payload.toUtf8(), text);
+    outgoing.prepared = true;
 #endif
 
-                m_ui->edit_Log->insertPlainText(QString("%1\n").arg(info.join(" :: ")));
-                m_ui->edit_Log->ensureCursorVisible();
-            }
+    Metrics::instance().record(Metrics::Histogram::SerializeMicroseconds, static_cast<uint64_t>(stage_timer.nsecsElapsed() / 1000));
+
+    return outgoing;
+}
+
+void MainWindow::slot_outgoing_ready()
+{
+    // the workers may finish out of order; copies are sent in the order
+    // they were made, so the group always ends up with the newest
+    while (!m_outgoing.empty() && m_outgoing.front()->isFinished())
+    {
+        auto watcher{m_outgoing.front()};
+        m_outgoing.pop_front();
+
+        auto outgoing{watcher->result()};
+        watcher->deleteLater();
+
+        // quitting
+        if (!m_multicast_sender)
+            continue;
+
+        // braodcast new clipboard text to peers
+        if (outgoing.prepared)
+            notify_clipboard_event(outgoing.payload, outgoing.message_id, outgoing.action, outgoing.security, outgoing.record, outgoing.text);
+        else
+        {
+            outgoing.record.outcome = flight::Outcome::SendFailed;
+            FlightRecorder::instance().record(outgoing.record);
         }
+
+        log(LogModel::Severity::Info, tr("Sending clipboard data to multicast group"));
+
+        m_history->append(m_sender_id, m_host_name, outgoing.text, outgoing.html);
     }
 }
 
@@ -475,8 +1789,11 @@ void MainWindow::slot_multicast_group_join()
     if (m_multicast_group_member)
     {
         disconnect(m_clipboard, &QClipboard::dataChanged, this, &MainWindow::slot_read_clipboard);
+        if (m_poller)
+            m_poller->stop();
 
-        m_ui->button_Channels_Join->setText(tr("Join"));
+        if (m_ui)
+            m_ui->button_Channels_Join->setText(tr("Join"));
 
         m_multicast_sender->deleteLater();
         m_multicast_sender = nullptr;
@@ -484,47 +1801,63 @@ void MainWindow::slot_multicast_group_join()
         m_multicast_receiver->deleteLater();
         m_multicast_receiver = nullptr;
 
-        m_security.clear();
+        // copies still in the pipelines belong to this membership
+        drop_pending();
+
+        m_wheel.cancel(m_key_promotion);
+        m_wheel.cancel(m_key_retirement);
+        m_key_promotion = m_key_retirement = 0;
+        m_keys.reset();
+        m_rejected_senders.clear();
     }
     else
     {
         connect(m_clipboard, &QClipboard::dataChanged, this, &MainWindow::slot_read_clipboard);
+        if (m_poller && m_clipboard_polling && !m_poller->start())
+            log(LogModel::Severity::Info, tr("Clipboard changes cannot be watched for on this display server; relying on its notifications"));
 
 #if defined(USE_ENCRYPTION)
-        m_use_encryption = m_ui->group_Encryption->isChecked() && !m_ui->line_Passphrase->text().isEmpty();
-
-        auto passphrase{m_ui->line_Passphrase->text()};
-        if (passphrase.isEmpty())
-            // is there placeholder text?
-            passphrase = m_ui->line_Passphrase->placeholderText();
-
-        m_security = Secure::create(passphrase);
+        m_use_encryption = m_settings.use_encryption && !m_settings.passphrase.isEmpty();
+
+        m_keys.reset(Secure::create(m_settings.passphrase, m_settings.cipher));
+        log(LogModel::Severity::Info, tr("Encrypting with %1").arg(crypto::name(m_keys.current()->cipher())));
+
+        // the default, "none", accepts every cipher, as does a name
+        // from_name() does not know; "auto" (the fastest cipher here) is a
+        // choice for sending, and as a minimum would refuse peers on CPUs
+        // that prefer the other AEAD
+        auto minimum{m_settings.minimum_cipher.toLower()};
+        m_minimum_cipher = crypto::Cipher::none;
+        if (!minimum.isEmpty() && minimum != "none" && minimum != "auto")
+            m_minimum_cipher = crypto::from_name(minimum);
 #endif
 
-        m_ui->button_Channels_Join->setText(tr("Leave"));
+        if (m_ui)
+            m_ui->button_Channels_Join->setText(tr("Leave"));
 
-        auto group_port_str{m_ui->line_MulticastGroupPort->text()};
+        // the empty fields fall back to the defaults the window shows as placeholders
+        auto group_port_str{m_settings.group_port};
         if (group_port_str.isEmpty())
-            group_port_str = m_ui->line_MulticastGroupPort->placeholderText();
+            group_port_str = default_group_port;
         auto group_port{static_cast<uint16_t>(group_port_str.toInt())};
 
         QString ipv4_multcast_group;
-        if (m_ui->check_Channels_IPv4->isChecked())
+        if (m_settings.ipv4_enabled)
         {
-            ipv4_multcast_group = m_ui->line_MulticastGroupIPv4->text();
+            ipv4_multcast_group = m_settings.ipv4_address;
             if (ipv4_multcast_group.isEmpty())
-                ipv4_multcast_group = m_ui->line_MulticastGroupIPv4->placeholderText();
+                ipv4_multcast_group = default_ipv4_group;
         }
 
         QString ipv6_multcast_group;
-        if (m_ui->check_Channels_IPv6->isChecked())
+        if (m_settings.ipv6_enabled)
         {
-            ipv6_multcast_group = m_ui->line_MulticastGroupIPv6->text();
+            ipv6_multcast_group = m_settings.ipv6_address;
             if (ipv6_multcast_group.isEmpty())
-                ipv6_multcast_group = m_ui->line_MulticastGroupIPv6->placeholderText();
+                ipv6_multcast_group = default_ipv6_group;
         }
 
-        if (m_randomized_addresses && (!m_ui->line_MulticastGroupIPv4->text().isEmpty() || !m_ui->line_MulticastGroupIPv6->text().isEmpty()))
+        if (m_randomized_addresses && (!m_settings.ipv4_address.isEmpty() || !m_settings.ipv6_address.isEmpty()))
         {
             QMessageBox::warning(
                 this,
@@ -546,6 +1879,50 @@ void MainWindow::slot_multicast_group_join()
     QTimer::singleShot(0, this, &MainWindow::slot_set_control_states);
 }
 
+void MainWindow::slot_stage_passphrase()
+{
+    if (!m_multicast_group_member || !m_keys.current())
+        return;
+
+    // expanding the key is the expensive part of a switch, so it is done
+    // now, while the current key is still in use
+    if (!m_keys.stage(Secure::create(m_settings.passphrase, m_settings.cipher)))
+    {
+        m_wheel.cancel(m_key_promotion);
+        m_key_promotion = 0;
+        return;
+    }
+
+    // members that change the passphrase at about the same time switch
+    // together, as soon as the first of them starts sending with it
+    m_wheel.cancel(m_key_promotion);
+    m_key_promotion = m_wheel.schedule(key_promotion_ms, this, [this]() {
+        m_key_promotion = 0;
+        promote_keys(tr("Switching to the new passphrase"));
+    });
+
+    log(LogModel::Severity::Info, tr("New passphrase staged; switching when a peer does, or in %1 seconds").arg(key_promotion_ms / 1000));
+}
+
+void MainWindow::promote_keys(const QString& reason)
+{
+    m_wheel.cancel(m_key_promotion);
+    m_key_promotion = 0;
+
+    m_keys.promote();
+
+    m_wheel.cancel(m_key_retirement);
+    m_key_retirement = m_wheel.schedule(key_retirement_ms, this, [this]() {
+        m_key_retirement = 0;
+        m_keys.retire();
+    });
+
+    // they may have been rejected for using the passphrase we now use
+    m_rejected_senders.clear();
+
+    log(LogModel::Severity::Info, reason);
+}
+
 void MainWindow::slot_randomize_ipv4()
 {
     std::random_device rd;
@@ -612,12 +1989,32 @@ void MainWindow::slot_set_startup()
 #endif
 }
 
+void MainWindow::slot_export_trace()
+{
+    auto default_name{QString("clipnet-trace-%1-%2.json").arg(m_host_name, QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss"))};
+    auto default_path{QDir(QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation)).filePath(default_name)};
+
+    auto file_name{QFileDialog::getSaveFileName(this, tr("Export trace"), default_path, tr("Chrome trace (*.json)"))};
+    if (file_name.isEmpty())
+        return;
+
+    QFile file(file_name);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        QMessageBox::warning(this, tr("Export trace"), tr("Could not write %1:\n%2").arg(file_name, file.errorString()));
+        return;
+    }
+
+    file.write(Trace::instance().export_chrome_json(m_sender_id, m_host_name));
+}
+
 void MainWindow::slot_clear_clipboard()
 {
     if (!m_ui->check_ClearClipboard->isChecked())
-        m_housekeeping_timer.stop();
-    else if (!m_housekeeping_timer.isActive())
-        m_housekeeping_timer.start();
+    {
+        m_wheel.cancel(m_clear_clipboard_timer);
+        m_clear_clipboard_timer = 0;
+    }
 
     QTimer::singleShot(0, this, &MainWindow::slot_set_control_states);
 }
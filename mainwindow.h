@@ -2,19 +2,39 @@
 
 #include <QMainWindow>
 
+#include <deque>
+#include <vector>
+
+#include <QSet>
+#include <QHash>
 #include <QMenu>
-#include <QTimer>
+#include <QPointer>
 #include <QAction>
+#include <QMimeData>
 #include <QClipboard>
+#include <QFutureWatcher>
 #include <QUdpSocket>
 #include <QCloseEvent>
+#include <QElapsedTimer>
+#include <QListWidgetItem>
 #include <QSystemTrayIcon>
 
+#include "Packet.h"
 #include "Secure.h"
 #include "Sender.h"
 #include "Receiver.h"
+#include "History.h"
+#include "KeyRing.h"
+#include "KeyStore.h"
+#include "HybridClock.h"
+#include "StatsServer.h"
+#include "TimerWheel.h"
+#include "FlightRecorder.h"
 
 #include "Cue.h"
+#include "LogModel.h"
+#include "ClipMimeData.h"
+#include "ClipboardPoller.h"
 
 #define ASSERT_UNUSED(cond) Q_ASSERT(cond); Q_UNUSED(cond)
 
@@ -23,9 +43,6 @@ namespace Ui
     class MainWindow;
 }
 
-constexpr int magic_number{('N' << 24) | ('T' << 16) | ('C' << 8) | 'L'};
-constexpr int multicast_port{45454};
-
 const int BroadcastPort = 59451;
 
 class MainWindow : public QMainWindow
@@ -49,8 +66,12 @@ private slots:
     void slot_tray_menu_action(QAction* action);
 
     void slot_process_peer_event(const QByteArray& datagram);
+    void slot_incoming_ready();
+    void slot_apply_newest();
 
     void slot_read_clipboard();
+    void slot_clipboard_polled();
+    void slot_outgoing_ready();
 
     void slot_quit();
 
@@ -63,40 +84,182 @@ private slots:
 
     void slot_clear_clipboard();
 
-    void slot_housekeeping();
+    void slot_stage_passphrase();
+
+    void slot_export_trace();
+
+    void slot_log_rows_inserted();
+
+
+    void slot_refresh_statistics();
+
+    void slot_populate_history_menu();
+    void slot_recall_history(QAction* action);
+    void slot_recall_history_item(QListWidgetItem* item);
+    void slot_search_history();
+    void slot_history_searched(const QString& query, const std::vector<History::Entry>& results);
+
+    void slot_store_ui_settings();
 
 private: // aliases and enums
-    enum class Action : uint32_t
+    // the persistent settings, kept apart from the widgets that edit them so
+    // they are available before (or without) the window ever being built
+    struct Settings
+    {
+        bool startup_enabled{false};
+        bool audio_cue{false};
+        bool visual_cue{false};
+
+        QString group_port;
+
+        bool ipv4_enabled{false};
+        QString ipv4_address;
+        bool ipv6_enabled{false};
+        QString ipv6_address;
+
+        bool autorejoin{false};
+
+        bool use_encryption{false};
+        QString passphrase;
+        QString cipher;             // what we encrypt with; "auto" for the fastest here
+        QString minimum_cipher;     // the weakest cipher we accept from peers; "none" for any
+
+        bool clear_clipboard{false};
+        QString clear_clipboard_seconds;
+
+        bool history{false};        // wanted, even if it is off for this session
+        int history_capacity{1000};
+    };
+
+    // the history's key, as fetched from the keystore on a worker
+    struct HistoryKey
     {
-        None,
-        ClipData,
+        keystore::Result result{keystore::Result::failed};
+        QByteArray key;
+        bool created{false};        // the keystore had none, and was given this one
     };
 
-    struct Packet
+    using history_key_watcher_t = QFutureWatcher<HistoryKey>;
+
+    // a local copy on its way to the group: taken from the clipboard on
+    // the GUI thread, turned into a payload on a worker
+    struct Outgoing
     {
-        int magic{magic_number}; // uniquely identifies this data as belonging to ClipNet
+        uint32_t message_id{0};
+        hlc::Timestamp stamp;
+        QString text;
+        QString html;
+        uint content_hash{0};       // set for copies announced by a preview
+        secure_ptr_t security;      // the key current when the copy was made
+        flight::Record record{};
+
+        Action action{Action::ClipData};
+        QByteArray payload;
+        bool prepared{false};
+    };
 
-        int sender{0}; // value unique to a sender; used to filter/discard captured packets
+    using outgoing_watcher_t = QFutureWatcher<Outgoing>;
 
-        int action{static_cast<uint32_t>(Action::None)};
-        int payload_size;
-        uint8_t payload[1];
+    // a peer's copy on its way to our clipboard: verified on the GUI
+    // thread, decoded into clipboard data on a worker, applied back on
+    // the GUI thread
+    struct Incoming
+    {
+        QByteArray data;            // the datagram, or a reassembled body
+        int payload_offset{0};
+        int payload_size{0};
+        Action action{Action::ClipData};
+        int sender{0};
+        uint32_t message_id{0};
+        secure_ptr_t security;      // the key of the packet's epoch
+        crypto::Cipher cipher{crypto::Cipher::none};
+        flight::Record record{};
+
+        QString host;
+        QString text;               // for a preview, the leading text
+        QString html;               // both left empty for a compressed copy
+        QByteArray text_block;      // a compressed copy's representations, as they arrived
+        QByteArray html_block;
+        QString excerpt;            // a compressed copy's leading text, if the sender provided it
+        qint64 sent{0};
+        hlc::Timestamp stamp;       // not set by peers that predate it
+
+        bool preview{false};        // announces a large copy whose body follows
+        int size{0};                // characters announced by a preview
+        uint content_hash{0};       // shared by a preview and its body
+
+        // ready for QClipboard, and owned by the GUI thread; null if the
+        // copy could not be decoded (record.outcome says why)
+        ClipMimeData* mime_data{nullptr};
     };
 
-#ifdef SIMPLECRYPT
-    using simplecrypt_ptr_t = QSharedPointer<SimpleCrypt>;
-#endif
+    using incoming_watcher_t = QFutureWatcher<Incoming>;
+
+    // the Fragment packets of a body received so far
+    struct Reassembly
+    {
+        QByteArray body;
+        std::vector<bool> received;
+        uint32_t remaining{0};
+        Action action{Action::ClipData};
+        secure_ptr_t security;      // every fragment must be under the same key and cipher
+        crypto::Cipher cipher{crypto::Cipher::none};
+        TimerWheel::timer_id_t expiry{0};
+        bool complete{false};       // kept until it expires, to ignore duplicate fragments
+        flight::Record record{};
+    };
 
 private: // methods
+    void ensure_ui();
+    void settings_to_ui();
     void build_tray_menu();
 
+    Cue* cue();
+
     void load_settings();
     void save_settings();
+    void open_history();
+    static HistoryKey fetch_history_key(QByteArray legacy_key);
+    void history_key_fetched(const HistoryKey& fetched);
+    void open_history_store(const QString& key);
 
-    void notify_clipboard_event(const QByteArray& payload, const QString& display = QString());
+    void notify_clipboard_event(const QByteArray& payload, uint32_t message_id, Action action, const secure_ptr_t& security, flight::Record& record, const QString& display = QString());
+
+    bool read_clipboard();
+    static Outgoing prepare_outgoing(Outgoing outgoing, QString host_name);
+    void send_preview(const Outgoing& outgoing);
+
+    void receive_fragment(const Packet* packet, const secure_ptr_t& security, crypto::Cipher cipher, flight::Record& record);
+    void release_reassembly(quint64 key);
+    void queue_incoming(const Incoming& incoming);
+
+    static Incoming decode_incoming(Incoming incoming);
+    void record_history(const Incoming& incoming);
+    void apply_incoming(Incoming& incoming);
+    void apply_preview(Incoming& incoming);
+    void abandon_preview(ClipMimeData* pending);
+    bool completes_preview(const Incoming& incoming) const;
+    void supersede_incoming(Incoming& incoming);
+
+    static bool later_than(const hlc::Timestamp& a, const hlc::Timestamp& b);
+
+    void open_apply_window();
+    void drop_pending();
+
+    void promote_keys(const QString& reason);
+
+    QJsonObject statistics_snapshot() const;
+
+    void log(LogModel::Severity severity, const QString& text);
+
+    void recall_history(uint64_t id);
 
 private: // data members
-    Ui::MainWindow* m_ui{nullptr};
+    Ui::MainWindow* m_ui{nullptr};     // built on first show
+
+    Settings m_settings;
+
+    LogModel* m_log_model{nullptr};
 
     QString m_host_name;
 
@@ -104,6 +267,13 @@ private: // data members
     QMenu* m_trayIconMenu{nullptr};
     QAction* m_restore_action{nullptr};
     QAction* m_quit_action{nullptr};
+    QAction* m_tracing_action{nullptr};
+    QAction* m_export_trace_action{nullptr};
+    QMenu* m_history_menu{nullptr};
+    QAction* m_history_search_action{nullptr};
+
+    // every deadline below is kept here
+    TimerWheel m_wheel;
 
     Sender* m_multicast_sender{nullptr};
     Receiver* m_multicast_receiver{nullptr};
@@ -112,19 +282,61 @@ private: // data members
 
     QClipboard* m_clipboard;
 
+    // backs up the clipboard's change notifications; null where they are reliable
+    ClipboardPoller* m_poller{nullptr};
+    bool m_clipboard_polling{true};
+
     int m_sender_id{0};
+    uint32_t m_message_id{0};
 
     bool m_is_visible{true};
     bool m_randomized_addresses{false};
 
-    QTimer m_housekeeping_timer;
-
-    int64_t m_clear_clipboard_countdown{0};
+    TimerWheel::timer_id_t m_clear_clipboard_timer{0};
 
     bool m_use_encryption{false};
-    secure_ptr_t m_security{nullptr};
+    KeyRing m_keys;
+    crypto::Cipher m_minimum_cipher{crypto::Cipher::none};
+    TimerWheel::timer_id_t m_key_promotion{0};
+    TimerWheel::timer_id_t m_key_retirement{0};
+
+    QSet<int> m_rejected_senders;
+    QHash<int, QString> m_peer_names;
+
+    History* m_history{nullptr};
+    QString m_legacy_history_key;   // from the settings file, until moved to the keystore
+    QElapsedTimer m_history_search_timer;
+
+    StatsServer* m_stats_server{nullptr};
+    TimerWheel::timer_id_t m_statistics_timer{0};
 
     int m_clipboard_debt{0};
 
+    // copies being prepared, oldest first; they are sent in this order
+    std::deque<outgoing_watcher_t*> m_outgoing;
+
+    // copies being decoded, in arrival order; they are applied in this order
+    std::deque<incoming_watcher_t*> m_incoming;
+
+    // a copy opens a window, and it and the copies that follow within it
+    // are held back; only the newest of them is applied when it closes
+    TimerWheel::timer_id_t m_apply_window{0};
+    Incoming m_newest_incoming;     // held if its mime_data is set
+
+    hlc::Clock m_clock;
+    hlc::Timestamp m_clipboard_stamp;   // of the copy now on the clipboard
+
+    // bodies arriving in fragments, by sender and message id
+    QHash<quint64, Reassembly> m_reassembly;
+    qint64 m_reassembly_bytes{0};       // held by the bodies still incomplete
+
+    // applied for a preview; its body fulfils it rather than replacing it
+    QPointer<ClipMimeData> m_pending_mime;
+    int m_pending_sender{0};
+    uint32_t m_pending_message_id{0};
+    uint m_pending_hash{0};
+    QString m_pending_host;
+    flight::Record m_pending_record{};
+
     CuePointer m_cue;
 };
@@ -0,0 +1,78 @@
+#include <QtTest>
+
+#include "Representation.h"
+
+// minify_html() must only drop whitespace a browser would not render.
+
+class TestRepresentation : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void minify_collapses_whitespace();
+    void minify_keeps_raw_elements();
+    void minify_keeps_styled_whitespace();
+    void minify_keeps_ide_fragment();
+    void choose_keeps_ide_fragment();
+};
+
+void TestRepresentation::minify_collapses_whitespace()
+{
+    QCOMPARE(Representation::minify_html("<p>one   two\n\tthree</p>\n\n<p>four</p>"), QString("<p>one two three</p> <p>four</p>"));
+    QCOMPARE(Representation::minify_html("<p>one<!-- a comment --> two</p>"), QString("<p>one two</p>"));
+}
+
+void TestRepresentation::minify_keeps_raw_elements()
+{
+    QString html{"<pre>int main()\n{\n    return 0;\n}</pre>"};
+    QCOMPARE(Representation::minify_html(html), html);
+}
+
+void TestRepresentation::minify_keeps_styled_whitespace()
+{
+    for (auto value : {"pre", "pre-wrap", "pre-line", "break-spaces"})
+    {
+        QString html{QString("<span style=\"white-space: %1\">a  b\n  c</span>").arg(value)};
+        QCOMPARE(Representation::minify_html(html), html);
+    }
+
+    // nested elements of the same name do not end it early, and the
+    // whitespace after it is collapsed again
+    QCOMPARE(Representation::minify_html("<div style=\"white-space:pre\"><div>  a</div>\n<div>  b</div></div>\n\n<p>c   d</p>"),
+             QString("<div style=\"white-space:pre\"><div>  a</div>\n<div>  b</div></div> <p>c d</p>"));
+
+    QCOMPARE(Representation::minify_html("<div style=\"color: red\">a   b</div>"), QString("<div style=\"color: red\">a b</div>"));
+}
+
+void TestRepresentation::minify_keeps_ide_fragment()
+{
+    // as VS Code puts a selection on the clipboard
+    QString html{"<meta charset='utf-8'><div style=\"color: #d4d4d4;background-color: #1e1e1e;font-family: Consolas, 'Courier New', "
+                 "monospace;font-weight: normal;font-size: 14px;line-height: 19px;white-space: pre;\">"
+                 "<div><span style=\"color: #569cd6;\">int</span><span style=\"color: #d4d4d4;\"> </span>"
+                 "<span style=\"color: #dcdcaa;\">main</span><span style=\"color: #d4d4d4;\">()</span></div>"
+                 "<div><span style=\"color: #d4d4d4;\">{</span></div>"
+                 "<div><span style=\"color: #d4d4d4;\">    </span><span style=\"color: #c586c0;\">return</span>"
+                 "<span style=\"color: #d4d4d4;\"> </span><span style=\"color: #b5cea8;\">0</span>"
+                 "<span style=\"color: #d4d4d4;\">;</span></div>"
+                 "<div><span style=\"color: #d4d4d4;\">}</span></div></div>"};
+    QCOMPARE(Representation::minify_html(html), html);
+
+    // as view-source pages style theirs
+    QString source{"<div style=\"white-space: pre-wrap\">if (x)\n{\n\tcall(x,  y);\n}\n</div>"};
+    QCOMPARE(Representation::minify_html(source), source);
+}
+
+void TestRepresentation::choose_keeps_ide_fragment()
+{
+    QString text{"int main()\n{\n    return 0;\n}"};
+    QString html{"<div style=\"white-space: pre;\"><div>int main()</div><div>{</div><div>    return 0;</div><div>}</div></div>"};
+
+    auto chosen{Representation::choose(text, html)};
+    QCOMPARE(chosen.html, html);
+    QVERIFY(chosen.text.isEmpty() || chosen.text == text);
+}
+
+QTEST_APPLESS_MAIN(TestRepresentation)
+
+#include "main.moc"
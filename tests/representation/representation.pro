@@ -0,0 +1,23 @@
+# What Representation keeps of the HTML a copy carries.
+
+TARGET = representation
+
+QT -= gui
+QT += core testlib
+
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+CLIPNET_ROOT = $$PWD/../..
+INCLUDEPATH += $$CLIPNET_ROOT
+
+SOURCES += \
+    main.cpp \
+    $$CLIPNET_ROOT/Representation.cpp
+
+HEADERS += \
+    $$CLIPNET_ROOT/Representation.h
+
+INTERMEDIATE_NAME = intermediate
+MOC_DIR = $$INTERMEDIATE_NAME/moc
+OBJECTS_DIR = $$INTERMEDIATE_NAME/obj
@@ -0,0 +1,8 @@
+# ClipNet unit tests, built with qmake and run with "make check":
+#
+#   qmake && make && make check
+
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    representation
@@ -0,0 +1,13 @@
+# Decodes the ClipNet flight recorder file (see FlightRecorder.h).
+# Plain C++; it does not need Qt at run time.
+
+TEMPLATE = app
+TARGET = flightdump
+
+CONFIG += c++17 console
+CONFIG -= app_bundle qt
+
+INCLUDEPATH += ../..
+
+SOURCES += main.cpp
+HEADERS += ../../FlightRecord.h
@@ -0,0 +1,163 @@
+// Decode a ClipNet flight recorder file.
+//
+//   flightdump [--json] [--last N] [file]
+//
+// With no file, the default location for this user is used.  Records are
+// printed oldest first; --json writes one JSON object per line instead of
+// the table.
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "FlightRecord.h"
+
+namespace
+{
+    std::string default_file_name()
+    {
+#if defined(_WIN32)
+        if (auto local = std::getenv("LOCALAPPDATA"))
+            return std::string(local) + "\\ClipNet\\flight.rec";
+#elif defined(__APPLE__)
+        if (auto home = std::getenv("HOME"))
+            return std::string(home) + "/Library/Application Support/ClipNet/flight.rec";
+#else
+        if (auto data = std::getenv("XDG_DATA_HOME"))
+            return std::string(data) + "/ClipNet/flight.rec";
+        if (auto home = std::getenv("HOME"))
+            return std::string(home) + "/.local/share/ClipNet/flight.rec";
+#endif
+        return "flight.rec";
+    }
+
+    std::string format_time(int64_t timestamp_ms)
+    {
+        auto seconds{static_cast<std::time_t>(timestamp_ms / 1000)};
+        std::tm local{};
+#if defined(_WIN32)
+        localtime_s(&local, &seconds);
+#else
+        localtime_r(&seconds, &local);
+#endif
+        char buffer[32];
+        std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &local);
+
+        std::ostringstream out;
+        out << buffer << '.' << std::setw(3) << std::setfill('0') << (timestamp_ms % 1000);
+        return out.str();
+    }
+
+    const char* direction_name(flight::Direction direction)
+    {
+        return direction == flight::Direction::Outgoing ? "out" : "in";
+    }
+
+    const char* const stage_names[2][flight::stage_count]{
+        {"snapshot", "serialize", "encrypt", "send"},
+        {"verify", "decrypt", "parse", "apply"},
+    };
+
+    int usage(const char* program)
+    {
+        std::cerr << "usage: " << program << " [--json] [--last N] [file]" << std::endl;
+        return 2;
+    }
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    bool json{false};
+    size_t last{0};
+    std::string file_name;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg{argv[i]};
+        if (arg == "--json")
+            json = true;
+        else if (arg == "--last" && i + 1 < argc)
+            last = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 10));
+        else if (arg == "-h" || arg == "--help")
+            return usage(argv[0]);
+        else if (file_name.empty())
+            file_name = arg;
+        else
+            return usage(argv[0]);
+    }
+
+    if (file_name.empty())
+        file_name = default_file_name();
+
+    std::ifstream in(file_name, std::ios::binary);
+    if (!in)
+    {
+        std::cerr << "flightdump: cannot open " << file_name << std::endl;
+        return 1;
+    }
+
+    flight::Header header{};
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != flight::magic)
+    {
+        std::cerr << "flightdump: " << file_name << " is not a ClipNet flight recorder file" << std::endl;
+        return 1;
+    }
+    if (header.version != flight::version || header.record_size != sizeof(flight::Record) || header.header_size != sizeof(flight::Header))
+    {
+        std::cerr << "flightdump: unsupported file version " << header.version << std::endl;
+        return 1;
+    }
+
+    std::vector<flight::Record> records(static_cast<size_t>(header.capacity));
+    in.read(reinterpret_cast<char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(flight::Record)));
+    records.resize(static_cast<size_t>(in.gcount()) / sizeof(flight::Record));
+
+    // drop never-written (or torn) slots and restore chronological order
+    records.erase(std::remove_if(records.begin(), records.end(), [](const flight::Record& r) { return r.sequence == 0; }), records.end());
+    std::sort(records.begin(), records.end(), [](const flight::Record& a, const flight::Record& b) { return a.sequence < b.sequence; });
+
+    if (last && records.size() > last)
+        records.erase(records.begin(), records.end() - static_cast<std::ptrdiff_t>(last));
+
+    if (!json)
+        std::cout << std::left << std::setw(24) << "time" << std::setw(4) << "dir" << std::setw(10) << "peer" << std::setw(10) << "message"
+                  << std::setw(16) << "outcome" << std::right << std::setw(10) << "payload" << std::setw(10) << "datagram"
+                  << "  stages (us)" << std::endl;
+
+    for (const auto& r : records)
+    {
+        auto direction{r.direction == flight::Direction::Outgoing ? 0 : 1};
+
+        if (json)
+        {
+            std::cout << "{\"sequence\":" << (r.sequence - 1) << ",\"timestamp_ms\":" << r.timestamp_ms << ",\"direction\":\""
+                      << direction_name(r.direction) << "\",\"peer\":\"" << std::hex << static_cast<uint32_t>(r.peer) << std::dec
+                      << "\",\"message_id\":" << r.message_id << ",\"outcome\":\"" << flight::name(r.outcome)
+                      << "\",\"payload_bytes\":" << r.payload_bytes << ",\"datagram_bytes\":" << r.datagram_bytes;
+            for (int s = 0; s < flight::stage_count; ++s)
+                std::cout << ",\"" << stage_names[direction][s] << "_us\":" << r.stage_us[s];
+            std::cout << "}\n";
+        }
+        else
+        {
+            std::ostringstream peer;
+            peer << std::hex << static_cast<uint32_t>(r.peer);
+
+            std::cout << std::left << std::setw(24) << format_time(r.timestamp_ms) << std::setw(4) << direction_name(r.direction)
+                      << std::setw(10) << peer.str() << std::setw(10) << r.message_id << std::setw(16) << flight::name(r.outcome)
+                      << std::right << std::setw(10) << r.payload_bytes << std::setw(10) << r.datagram_bytes << " ";
+            for (int s = 0; s < flight::stage_count; ++s)
+                std::cout << ' ' << stage_names[direction][s] << '=' << r.stage_us[s];
+            std::cout << "\n";
+        }
+    }
+
+    return 0;
+}